@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "adapt.h"
+
+_Static_assert(ADAPT_MIN_PERIOD_MS <= ADAPT_MAX_PERIOD_MS, "ADAPT_MIN_PERIOD_MS must not exceed ADAPT_MAX_PERIOD_MS");
+
+static uint32_t base_ms;
+static uint32_t interval_ms;
+
+// Each sensor's previous sample, to measure its step from
+static history_sample last[DHT_SENSOR_COUNT];
+static bool have_last[DHT_SENSOR_COUNT];
+
+// The round so far: whether it has a step, every step was calm, any was
+// fast, and its largest step as a share of the fast thresholds
+static bool round_steps;
+static bool round_calm;
+static bool round_fast;
+static uint round_change;
+static uint last_change;
+static uint calm_rounds;
+
+// Counts for adapt_dump
+static uint32_t rounds;
+static uint32_t first_ms;
+static uint32_t latest_ms;
+static uint32_t widened;
+static uint32_t tightened;
+
+/*
+ *	Starts a new round with nothing in it
+ */
+void adapt_clear_round() {
+	round_steps = false;
+	round_calm = true;
+	round_fast = false;
+	round_change = 0;
+}
+
+void adapt_init(uint32_t initial_ms) {
+	base_ms = initial_ms;
+	interval_ms = MIN(MAX(initial_ms, ADAPT_MIN_PERIOD_MS), ADAPT_MAX_PERIOD_MS);
+	for (uint i = 0; i < DHT_SENSOR_COUNT; ++i) {
+		have_last[i] = false;
+	}
+	adapt_clear_round();
+	last_change = 0;
+	calm_rounds = 0;
+	rounds = 0;
+	widened = 0;
+	tightened = 0;
+}
+
+void adapt_push(uint sensor, const history_sample *sample) {
+	if (have_last[sensor]) {
+		uint temp = abs(sample->temp_tenths - last[sensor].temp_tenths);
+		uint humidity = abs((int)sample->humidity_tenths - (int)last[sensor].humidity_tenths);
+		round_steps = true;
+		round_calm = round_calm && temp <= ADAPT_CALM_TEMP && humidity <= ADAPT_CALM_HUMIDITY;
+		round_fast = round_fast || temp >= ADAPT_FAST_TEMP || humidity >= ADAPT_FAST_HUMIDITY;
+		round_change = MAX(round_change, MAX(temp * 100 / ADAPT_FAST_TEMP, humidity * 100 / ADAPT_FAST_HUMIDITY));
+	}
+	last[sensor] = *sample;
+	have_last[sensor] = true;
+}
+
+uint32_t adapt_update(uint32_t time_ms) {
+	if (rounds++ == 0) {
+		first_ms = time_ms;
+	}
+	latest_ms = time_ms;
+	if (!round_steps) {
+		// nothing to compare yet, or every read failed
+		return interval_ms;
+	}
+
+	uint32_t old_ms = interval_ms;
+	if (round_fast) {
+		interval_ms = ADAPT_MIN_PERIOD_MS;
+		calm_rounds = 0;
+	} else if (round_calm) {
+		if (++calm_rounds >= ADAPT_CALM_ROUNDS) {
+			interval_ms = MIN(interval_ms * 2, ADAPT_MAX_PERIOD_MS);
+			calm_rounds = 0;
+		}
+	} else {
+		// still moving; speed up if the change is picking up
+		if (round_change > last_change) {
+			interval_ms = MAX(interval_ms / 2, ADAPT_MIN_PERIOD_MS);
+		}
+		calm_rounds = 0;
+	}
+	last_change = round_change;
+	adapt_clear_round();
+
+	if (interval_ms > old_ms) {
+		++widened;
+	} else if (interval_ms < old_ms) {
+		++tightened;
+	}
+	return interval_ms;
+}
+
+uint32_t adapt_period_ms() {
+	return interval_ms;
+}
+
+void adapt_dump() {
+	uint32_t fixed = rounds ? (latest_ms - first_ms) / base_ms + 1 : 0;
+	printf("sampling: every %lu ms (%u-%u), %lu rounds where every %lu ms would take %lu, widened %lu, tightened %lu\n",
+		(unsigned long)interval_ms, ADAPT_MIN_PERIOD_MS, ADAPT_MAX_PERIOD_MS, (unsigned long)rounds,
+		(unsigned long)base_ms, (unsigned long)fixed, (unsigned long)widened, (unsigned long)tightened);
+}
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _ADAPT_H
+#define _ADAPT_H
+
+#include "pico/stdlib.h"
+#include "dht.h"
+#include "history.h"
+
+// The time between samples follows how fast the readings change. Each
+// round of readings is calm, moving or fast by the largest step any sensor
+// took since its last sample:
+//
+//	calm    every step within the calm thresholds; after ADAPT_CALM_ROUNDS
+//	        calm rounds in a row the interval doubles, up to the maximum
+//	moving  between the two; the interval holds, or halves if the step
+//	        grew since the last round
+//	fast    any step at or past the fast thresholds; the interval drops
+//	        straight to the minimum
+//
+// The gap between the thresholds and the run of calm rounds a widening
+// needs keep sensor noise from pulling the rate up and down.
+
+// Bounds of the interval; the default minimum is the sensor's own
+#ifndef ADAPT_MIN_PERIOD_MS
+#define ADAPT_MIN_PERIOD_MS DHT_MIN_INTERVAL_MS
+#endif
+#ifndef ADAPT_MAX_PERIOD_MS
+#define ADAPT_MAX_PERIOD_MS 30000
+#endif
+
+#define ADAPT_CALM_ROUNDS 5
+
+// Steps in tenths; the DHT11 reads whole degrees and percent, so one count
+// either way is noise
+#if !SENSOR_SHT3X && !SENSOR_DHT22
+#define ADAPT_CALM_TEMP 10
+#define ADAPT_FAST_TEMP 20
+#define ADAPT_CALM_HUMIDITY 10
+#define ADAPT_FAST_HUMIDITY 30
+#else
+#define ADAPT_CALM_TEMP 2
+#define ADAPT_FAST_TEMP 5
+#define ADAPT_CALM_HUMIDITY 5
+#define ADAPT_FAST_HUMIDITY 15
+#endif
+
+/*
+ *	Starts over at `period_ms`, the fixed interval the savings are counted against
+ */
+void adapt_init(uint32_t period_ms);
+
+/*
+ *	Notes a new sample of `sensor` towards the current round
+ */
+void adapt_push(uint sensor, const history_sample *sample);
+
+/*
+ *	Ends the round of samples pushed since the last call, at `time_ms`
+ *
+ *	Returns the interval until the next round.
+ */
+uint32_t adapt_update(uint32_t time_ms);
+
+/*
+ *	Returns the interval until the next round
+ */
+uint32_t adapt_period_ms();
+
+/*
+ *	Prints the interval, rounds sampled against those the fixed interval would have taken, and the changes of rate
+ */
+void adapt_dump();
+
+#endif
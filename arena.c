@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include "arena.h"
+#include "hardware/sync.h"
+
+// What each module takes: the history rings, statistics windows and flash
+// log pages of every sensor, and the network packet buffers
+#ifndef ARENA_SIZE
+#include "history.h"
+#include "flashlog.h"
+#include "stats.h"
+#if NET
+#include "net.h"
+#else
+#define NET_ARENA_BYTES 0
+#endif
+#define ARENA_SIZE (HISTORY_ARENA_BYTES + STATS_ARENA_BYTES + FLASHLOG_ARENA_BYTES + NET_ARENA_BYTES)
+#endif
+
+_Static_assert(ARENA_SIZE % ARENA_ALIGN == 0, "ARENA_SIZE must be a multiple of ARENA_ALIGN");
+
+static uint8_t __uninitialized_ram(arena)[ARENA_SIZE] __attribute__((aligned(ARENA_ALIGN)));
+static uint used = 0;
+static bool sealed = false;
+static bool retained = false;
+
+void arena_init(bool keep) {
+	retained = keep;
+}
+
+bool arena_retained() {
+	return retained;
+}
+
+void *arena_alloc(size_t size) {
+	size = ARENA_BYTES(size);
+	if (sealed) {
+		panic("arena_alloc after startup");
+	}
+	if (size > ARENA_SIZE - used) {
+		panic("arena out of room for %u bytes, %u of %u used", (uint)size, used, (uint)ARENA_SIZE);
+	}
+	void *block = &arena[used];
+	if (!retained) {
+		memset(block, 0, size);
+	}
+	used += size;
+	return block;
+}
+
+void arena_seal() {
+	sealed = true;
+}
+
+uint arena_used() {
+	return used;
+}
+
+uint arena_size() {
+	return ARENA_SIZE;
+}
+
+void arena_pool_init(arena_pool *pool, uint block_size, uint count) {
+	if (count > ARENA_POOL_MAX_BLOCKS) {
+		panic("arena pool of %u blocks is too big", count);
+	}
+	pool->block_size = ARENA_BYTES(block_size);
+	pool->count = count;
+	pool->blocks = arena_alloc(pool->block_size * count);
+	pool->free = (count == 32) ? 0xffffffff : (1u << count) - 1;
+}
+
+void *arena_pool_take(arena_pool *pool) {
+	uint32_t status = save_and_disable_interrupts();
+	uint32_t free = pool->free;
+	void *block = NULL;
+	if (free) {
+		uint i = __builtin_ctz(free);
+		pool->free = free & ~(1u << i);
+		block = pool->blocks + i * pool->block_size;
+	}
+	restore_interrupts(status);
+	return block;
+}
+
+void arena_pool_give(arena_pool *pool, void *block) {
+	uint i = arena_pool_index(pool, block);
+	uint32_t status = save_and_disable_interrupts();
+	pool->free |= 1u << i;
+	restore_interrupts(status);
+}
+
+uint arena_pool_index(const arena_pool *pool, const void *block) {
+	return ((const uint8_t *)block - pool->blocks) / pool->block_size;
+}
+
+void arena_dump() {
+	printf("arena: %u of %u bytes used%s%s\n", used, (uint)ARENA_SIZE, sealed ? ", sealed" : "", retained ? ", retained" : "");
+}
@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include "pico/stdlib.h"
+
+// Buffers whose size depends on the build configuration are handed out from
+// one static arena at startup rather than declared for the most sensors
+// there could be. Nothing is ever given back to the arena, so it cannot
+// fragment; buffers that come and go, like network packets, are taken from
+// fixed-size pools carved out of it.
+//
+// The arena is exactly as big as what the modules take from it for
+// DHT_SENSOR_COUNT sensors, so it shows up whole in the build's memory
+// report and running out of it is a bug caught at the first boot. It is
+// not cleared by the runtime at boot, so after a warm restart it holds
+// what it did before.
+
+// Alignment of everything the arena hands out
+#define ARENA_ALIGN 8
+
+// Bytes the arena gives an allocation of `size`
+#define ARENA_BYTES(size) (((size) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+
+// Fixed-size blocks taken and given back in any order, from any context
+typedef struct {
+	uint8_t *blocks;
+	uint block_size;
+	uint count;
+	volatile uint32_t free;  // bit i set while block i is free
+} arena_pool;
+
+#define ARENA_POOL_MAX_BLOCKS 32
+
+/*
+ *	Starts handing out memory; with `retained`, what it holds is kept from before a warm restart
+ */
+void arena_init(bool retained);
+
+/*
+ *	Returns true if allocations hold what they did before a warm restart
+ *
+ *	Modules hand out the same allocations in the same order on every boot,
+ *	so each gets back its own state.
+ */
+bool arena_retained();
+
+/*
+ *	Hands out `size` bytes for the rest of the run, zeroed unless retained
+ *
+ *	Only for startup: panics once arena_seal has been called, or if the
+ *	arena is out of room.
+ */
+void *arena_alloc(size_t size);
+
+/*
+ *	Ends startup; any later arena_alloc is a bug
+ */
+void arena_seal();
+
+/*
+ *	Returns the bytes handed out so far
+ */
+uint arena_used();
+
+/*
+ *	Returns the size of the arena
+ */
+uint arena_size();
+
+/*
+ *	Carves a pool of `count` blocks of `block_size` bytes out of the arena
+ */
+void arena_pool_init(arena_pool *pool, uint block_size, uint count);
+
+/*
+ *	Takes a free block, or returns NULL if every block is in use
+ */
+void *arena_pool_take(arena_pool *pool);
+
+/*
+ *	Gives back a block taken from `pool`
+ */
+void arena_pool_give(arena_pool *pool, void *block);
+
+/*
+ *	Returns the position of `block` in `pool`
+ */
+uint arena_pool_index(const arena_pool *pool, const void *block);
+
+/*
+ *	Prints how much of the arena is used
+ */
+void arena_dump();
+
+#endif
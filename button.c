@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "button.h"
+#include "sched.h"
+#include "hardware/gpio.h"
+
+static uint button_pin;
+static button_events events;
+
+// Integrator of the sampled line, from 0 (released) to BUTTON_INTEGRATE_MS (pressed)
+static uint level = 0;
+static bool pressed = false;
+static bool sampling = false;
+static repeating_timer_t sample_timer;
+
+static uint32_t edge_time_us;
+static uint32_t press_time_us;
+static uint32_t release_time_us;
+static bool released_once = false;
+
+// Milliseconds the current press has been held, and what it has posted
+static uint held_ms;
+static bool long_posted;
+static bool double_press;
+
+void button_edge_callback(uint gpio, uint32_t event_mask);
+
+/*
+ *	Confirms a press or release once the line has been steady for BUTTON_INTEGRATE_MS
+ */
+bool button_sample_callback(repeating_timer_t *timer) {
+	uint32_t now = time_us_32();
+	if (gpio_get(button_pin)) {
+		level = MIN(level + 1, BUTTON_INTEGRATE_MS);
+	} else if (level > 0) {
+		--level;
+	}
+
+	if (!pressed && level == BUTTON_INTEGRATE_MS) {
+		pressed = true;
+		held_ms = 0;
+		long_posted = false;
+		press_time_us = edge_time_us;
+		double_press = released_once && now - release_time_us < BUTTON_DOUBLE_MS * 1000;
+		sched_post(events.down);
+		if (double_press) {
+			sched_post(events.double_press);
+		}
+	} else if (pressed && level == 0) {
+		pressed = false;
+		release_time_us = now;
+		released_once = true;
+		if (!long_posted && !double_press) {
+			sched_post(events.short_press);
+		}
+	} else if (pressed && ++held_ms == BUTTON_LONG_MS && !double_press) {
+		long_posted = true;
+		sched_post(events.long_press);
+	}
+
+	// stop sampling once the line has settled released, and listen for the next edge
+	if (!pressed && level == 0) {
+		sampling = false;
+		gpio_set_irq_enabled_with_callback(button_pin, GPIO_IRQ_EDGE_RISE, true, button_edge_callback);
+		return false;
+	}
+	return true;
+}
+
+/*
+ *	Starts sampling on the first edge of a press; bounces after it are left to the integrator
+ */
+void button_edge_callback(uint gpio, uint32_t event_mask) {
+	if (gpio != button_pin || sampling) {
+		return;
+	}
+	gpio_set_irq_enabled(button_pin, GPIO_IRQ_EDGE_RISE, false);
+	sampling = true;
+	edge_time_us = time_us_32();
+	add_repeating_timer_ms(-1, button_sample_callback, NULL, &sample_timer);
+}
+
+void button_init(uint pin, const button_events *button_events) {
+	button_pin = pin;
+	events = *button_events;
+
+	gpio_init(pin);
+	gpio_set_dir(pin, GPIO_IN);
+	gpio_pull_down(pin);
+	gpio_set_irq_enabled_with_callback(pin, GPIO_IRQ_EDGE_RISE, true, button_edge_callback);
+}
+
+uint32_t button_press_time_us() {
+	return press_time_us;
+}
@@ -0,0 +1,43 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _BUTTON_H
+#define _BUTTON_H
+
+#include "pico/stdlib.h"
+
+// The line is sampled every millisecond while the button is active, and a
+// press or release counts once it has held for this many samples in a row
+#define BUTTON_INTEGRATE_MS 5
+
+// Held at least this long, a press is a long press
+#define BUTTON_LONG_MS 700
+
+// A press starting this soon after the last release is a double press
+#define BUTTON_DOUBLE_MS 300
+
+// Scheduler events posted by the debouncer
+typedef struct {
+	uint down;          // a press is confirmed
+	uint short_press;   // released before BUTTON_LONG_MS, other than the second press of a double
+	uint long_press;    // held for BUTTON_LONG_MS; posted while still held
+	uint double_press;  // a second press has been confirmed within BUTTON_DOUBLE_MS
+} button_events;
+
+/*
+ *	Starts debouncing an active-high button on `pin`, posting `events` to the scheduler
+ *
+ *	Short presses are posted on release without waiting to see if a double
+ *	press follows, so the first press of a double also posts short_press.
+ */
+void button_init(uint pin, const button_events *events);
+
+/*
+ *	Returns the time of the first edge of the latest press, from time_us_32
+ */
+uint32_t button_press_time_us();
+
+#endif
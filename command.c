@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <string.h>
+#include "command.h"
+#include "crc.h"
+
+// Frame being received: its bytes so far, and when the last one came
+static uint8_t received[sizeof(command_frame) + sizeof(uint16_t)];
+static uint count = 0;
+static uint32_t last_ms;
+
+// Bytes still to come of a frame too long to take, which are swallowed
+// rather than taken for letters
+static uint skip = 0;
+
+bool command_feed(uint8_t c, uint32_t time_ms, command_frame *frame, bool *ready) {
+	*ready = false;
+	if ((count || skip) && time_ms - last_ms > COMMAND_TIMEOUT_MS) {
+		count = 0;
+		skip = 0;
+	}
+	last_ms = time_ms;
+	if (skip) {
+		--skip;
+		return true;
+	}
+
+	if (count == 0) {
+		if (c != COMMAND_MAGIC0) {
+			return false;
+		}
+	} else if (count == 1 && c != COMMAND_MAGIC1) {
+		count = 0;
+		return command_feed(c, time_ms, frame, ready);
+	}
+	received[count++] = c;
+	if (count < sizeof(telemetry_header)) {
+		return true;
+	}
+
+	telemetry_header header;
+	memcpy(&header, received, sizeof(header));
+	if (header.length > COMMAND_MAX_PAYLOAD) {
+		// a garbled length could say anything, but a pause still ends it
+		skip = header.length + sizeof(uint16_t);
+		count = 0;
+		return true;
+	}
+	uint end = sizeof(header) + header.length + sizeof(uint16_t);
+	if (count < end) {
+		return true;
+	}
+
+	count = 0;
+	uint16_t crc;
+	memcpy(&crc, received + end - sizeof(crc), sizeof(crc));
+	if (crc != crc16_update(CRC16_INIT, received, end - sizeof(crc))) {
+		return true;
+	}
+	memset(frame, 0, sizeof(*frame));
+	memcpy(frame, received, end - sizeof(crc));
+	*ready = true;
+	return true;
+}
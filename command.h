@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _COMMAND_H
+#define _COMMAND_H
+
+#include "pico/stdlib.h"
+#include "telemetry.h"
+
+// Binary commands sent to the thermometer over USB CDC, framed like the
+// telemetry frames it sends back (see telemetry.h) but with the magic
+// 'T' 'C'. The sequence is the host's own, echoed in the reply, and the
+// payload is at most COMMAND_MAX_PAYLOAD bytes. Every command is answered
+// with a TELEMETRY_REPLY frame; tools/config.py sends them.
+//
+// Bytes outside a frame are the single-letter commands.
+
+#define COMMAND_MAGIC0 'T'
+#define COMMAND_MAGIC1 'C'
+
+#define COMMAND_MAX_PAYLOAD 8
+
+// A frame whose bytes stop for this long is dropped, so a host that gave up
+// half way does not swallow the letters typed after it
+#define COMMAND_TIMEOUT_MS 500
+
+typedef enum {
+	COMMAND_GET = 1,       // replies with the settings
+	COMMAND_SET = 2,       // index is a config_key, payload its u32 value; replies with the settings
+	COMMAND_SAVE = 3,      // saves the settings to flash
+	COMMAND_DEFAULTS = 4,  // puts the settings back to the build's defaults, until saved
+	COMMAND_DUMP = 5,      // dumps flash log pages from sequence index, payload the u32 number of pages
+} command_type;
+
+// Status of a reply, in its sensor byte
+typedef enum {
+	COMMAND_OK = 0,
+	COMMAND_UNKNOWN = 1,  // no such command
+	COMMAND_INVALID = 2,  // bad key, value or payload length
+} command_status;
+
+typedef struct {
+	telemetry_header header;
+	uint8_t payload[COMMAND_MAX_PAYLOAD];
+} command_frame;
+
+/*
+ *	Feeds a byte received at `time_ms` to the frame decoder
+ *
+ *	Returns false if the byte is not part of a frame, so is a single-letter
+ *	command. Returns true otherwise, and sets `*ready` once `frame` holds a
+ *	whole frame with a good CRC.
+ */
+bool command_feed(uint8_t c, uint32_t time_ms, command_frame *frame, bool *ready);
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <string.h>
+#include "config.h"
+#include "crc.h"
+
+#define CONFIG_SLOTS (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+
+// End of the firmware image, from the linker script
+extern char __flash_binary_end;
+
+static const config_field *fields;
+static uint32_t values[CONFIG_KEYS];
+
+// Sequence of the newest saved page, and whether there is one
+static uint32_t saved_sequence;
+static bool saved_any = false;
+
+/*
+ *	Returns the page in slot `slot` of the sector, mapped through XIP
+ */
+const config_page *config_page_at(uint slot) {
+	return (const config_page *)(uintptr_t)(XIP_BASE + CONFIG_OFFSET + slot * FLASH_PAGE_SIZE);
+}
+
+uint16_t config_crc(const config_page *page) {
+	return crc16_update(CRC16_INIT, &page->sequence, sizeof(config_page) - offsetof(config_page, sequence));
+}
+
+void config_init(const config_field defaults[CONFIG_KEYS]) {
+	if ((uintptr_t)&__flash_binary_end - XIP_BASE > CONFIG_OFFSET) {
+		panic("config sector overlaps the firmware");
+	}
+	fields = defaults;
+	config_reset();
+
+	// pages are written in sequence around the sector, so the newest is the
+	// intact one with the highest number
+	const config_page *newest = NULL;
+	for (uint i = 0; i < CONFIG_SLOTS; ++i) {
+		const config_page *page = config_page_at(i);
+		if (page->magic == CONFIG_MAGIC && page->crc == config_crc(page)
+				&& (!newest || (int32_t)(page->sequence - newest->sequence) > 0)) {
+			newest = page;
+		}
+	}
+	if (!newest) {
+		return;
+	}
+	saved_any = true;
+	saved_sequence = newest->sequence;
+	for (uint i = 0; i < MIN(newest->keys, CONFIG_KEYS); ++i) {
+		config_set(i, newest->values[i]);
+	}
+}
+
+uint32_t config_get(config_key key) {
+	return values[key];
+}
+
+const uint32_t *config_values() {
+	return values;
+}
+
+bool config_set(uint key, uint32_t value) {
+	if (key >= CONFIG_KEYS || value < fields[key].min || value > fields[key].max) {
+		return false;
+	}
+	values[key] = value;
+	return true;
+}
+
+void config_reset() {
+	for (uint i = 0; i < CONFIG_KEYS; ++i) {
+		values[i] = fields[i].value;
+	}
+}
+
+void config_save() {
+	static config_page page;
+	uint32_t sequence = saved_any ? saved_sequence + 1 : 0;
+	memset(&page, 0, sizeof(page));
+	page.magic = CONFIG_MAGIC;
+	page.sequence = sequence;
+	page.keys = CONFIG_KEYS;
+	memcpy(page.values, values, sizeof(values));
+	page.crc = config_crc(&page);
+
+	// a slot is only written once per erase, so the first one of the sector
+	// erases it
+	uint slot = sequence % CONFIG_SLOTS;
+	flashlog_program(CONFIG_OFFSET + slot * FLASH_PAGE_SIZE, &page, slot == 0);
+	saved_any = true;
+	saved_sequence = sequence;
+}
@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "flashlog.h"
+
+// Settings that can be changed at runtime over USB and saved to flash, in
+// the sector below the flash log. Each save goes in the next page of the
+// sector, so it is erased once every 16 saves, and startup takes the newest
+// intact page. The build options are the defaults.
+
+#define CONFIG_OFFSET (FLASHLOG_OFFSET - FLASH_SECTOR_SIZE)
+#define CONFIG_MAGIC 0x4643  // "CF"
+
+// Settings, in the order their values are sent and saved; new ones go at
+// the end, so a page saved by older firmware still loads
+typedef enum {
+	CONFIG_SAMPLE_PERIOD_MS,  // interval the adaptive sampler starts from
+	CONFIG_DISPLAY_TIME_MS,   // time a reading stays on the display
+	CONFIG_DISPLAY_MODE,      // render_mode shown when the display comes on
+	CONFIG_FAHRENHEIT,        // 1 for fahrenheit, 0 for celsius
+	CONFIG_BRIGHTNESS,        // level up to DISPLAY_BRIGHTNESS_LEVELS - 1
+	CONFIG_SENSORS,           // mask of the sensors that are sampled
+	CONFIG_KEYS,
+} config_key;
+
+// Default and bounds of a setting
+typedef struct {
+	uint32_t value;
+	uint32_t min;
+	uint32_t max;
+} config_field;
+
+typedef struct {
+	uint16_t magic;
+	uint16_t crc;       // CRC-16/CCITT-FALSE of everything after this field
+	uint32_t sequence;  // saves since the sector was first written
+	uint32_t keys;      // values that follow
+	uint32_t values[CONFIG_KEYS];
+	uint8_t reserved[FLASH_PAGE_SIZE - 12 - 4 * CONFIG_KEYS];
+} config_page;
+
+_Static_assert(sizeof(config_page) == FLASH_PAGE_SIZE, "config_page must fill one flash page");
+
+/*
+ *	Loads the newest saved settings, taking the defaults and bounds from `defaults`
+ *
+ *	A setting that is missing or out of bounds gets its default.
+ */
+void config_init(const config_field defaults[CONFIG_KEYS]);
+
+/*
+ *	Returns the current value of `key`
+ */
+uint32_t config_get(config_key key);
+
+/*
+ *	Returns every current value, indexed by config_key
+ */
+const uint32_t *config_values();
+
+/*
+ *	Changes `key` to `value` until the next restart, or for good once saved
+ *
+ *	Returns false, leaving it unchanged, if `key` is unknown or `value` out of bounds.
+ */
+bool config_set(uint key, uint32_t value);
+
+/*
+ *	Puts every setting back to its default
+ */
+void config_reset();
+
+/*
+ *	Saves the current values to flash
+ *
+ *	Stalls interrupts like flashlog_flush, so only call this while no sensor
+ *	read is in progress.
+ */
+void config_save();
+
+#endif
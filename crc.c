@@ -0,0 +1,34 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "crc.h"
+
+// CRC of each 4-bit value, so a byte takes two lookups in a 32-byte table
+static const uint16_t CRC16_NIBBLES[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+	0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+uint16_t crc16_update(uint16_t crc, const void *data, size_t len) {
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; ++i) {
+		crc = (crc << 4) ^ CRC16_NIBBLES[(crc >> 12) ^ (bytes[i] >> 4)];
+		crc = (crc << 4) ^ CRC16_NIBBLES[(crc >> 12) ^ (bytes[i] & 0xf)];
+	}
+	return crc;
+}
+
+uint8_t crc8_update(uint8_t crc, const void *data, size_t len) {
+	// only ever a few bytes at a time, so bitwise rather than a table
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; ++i) {
+		crc ^= bytes[i];
+		for (uint bit = 0; bit < 8; ++bit) {
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+		}
+	}
+	return crc;
+}
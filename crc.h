@@ -0,0 +1,30 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _CRC_H
+#define _CRC_H
+
+#include "pico/stdlib.h"
+
+// Initial value of a CRC-16/CCITT-FALSE
+#define CRC16_INIT 0xffff
+
+/*
+ *	Continues a CRC-16/CCITT-FALSE (polynomial 0x1021) over `len` bytes
+ *
+ *	Start with CRC16_INIT; data can be fed in several pieces.
+ */
+uint16_t crc16_update(uint16_t crc, const void *data, size_t len);
+
+// Initial value of a Sensirion CRC-8
+#define CRC8_INIT 0xff
+
+/*
+ *	Continues a CRC-8 with polynomial 0x31, as Sensirion sensors check their words with
+ */
+uint8_t crc8_update(uint8_t crc, const void *data, size_t len);
+
+#endif
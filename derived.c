@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "derived.h"
+#include "dht.h"
+#include "derived_tables.h"
+
+/*
+ *	Linearly interpolates between `a` and `b`, `frac` of the way over `den`
+ */
+int lerp(int a, int b, int frac, int den) {
+	return a + (b - a) * frac / den;
+}
+
+int derived_dew_point(int temp_tenths, uint humidity_tenths) {
+	temp_tenths = MAX(MIN(temp_tenths, DEW_TEMP_MAX * 10), DEW_TEMP_MIN * 10);
+	humidity_tenths = MAX(MIN(humidity_tenths, 1000u), 10u);
+
+	// gamma = ln(rh / 100) + a * t / (b + t), each read from its table
+	uint rh = humidity_tenths / 10;
+	int gamma = lerp(DEW_LN_RH[rh], DEW_LN_RH[MIN(rh + 1, 100u)], humidity_tenths % 10, 10);
+	uint t = (temp_tenths - DEW_TEMP_MIN * 10) / 10;
+	uint t_frac = (temp_tenths - DEW_TEMP_MIN * 10) % 10;
+	gamma += lerp(DEW_GAMMA_T[t], DEW_GAMMA_T[MIN(t + 1, (uint)(DEW_TEMP_MAX - DEW_TEMP_MIN))], t_frac, 10);
+
+	// dew point = b * gamma / (a - gamma)
+	int offset = gamma - DEW_GAMMA_MIN;
+	if (offset <= 0) {
+		return DEW_POINT[0];
+	}
+	uint i = offset >> DEW_GAMMA_STEP_SHIFT;
+	if (i >= DEW_GAMMA_COUNT - 1) {
+		return DEW_POINT[DEW_GAMMA_COUNT - 1];
+	}
+	return lerp(DEW_POINT[i], DEW_POINT[i + 1], offset & ((1 << DEW_GAMMA_STEP_SHIFT) - 1), 1 << DEW_GAMMA_STEP_SHIFT);
+}
+
+int derived_heat_index(int temp_tenths, uint humidity_tenths) {
+	int fahrenheit = dht_celsius_to_fahrenheit(temp_tenths);
+	if (fahrenheit < HEAT_TEMP_MIN * 10) {
+		return temp_tenths;
+	}
+	fahrenheit = MIN(fahrenheit, HEAT_TEMP_MAX * 10);
+	humidity_tenths = MIN(humidity_tenths, 1000u);
+
+	// bilinear interpolation over the temperature and humidity steps
+	uint t = (fahrenheit - HEAT_TEMP_MIN * 10) / (HEAT_TEMP_STEP * 10);
+	uint t_frac = (fahrenheit - HEAT_TEMP_MIN * 10) % (HEAT_TEMP_STEP * 10);
+	uint t_next = MIN(t + 1, (uint)((HEAT_TEMP_MAX - HEAT_TEMP_MIN) / HEAT_TEMP_STEP));
+	uint rh = humidity_tenths / (HEAT_RH_STEP * 10);
+	uint rh_frac = humidity_tenths % (HEAT_RH_STEP * 10);
+	uint rh_next = MIN(rh + 1, (uint)(HEAT_RH_COUNT - 1));
+
+	int low = lerp(HEAT_INDEX[t * HEAT_RH_COUNT + rh], HEAT_INDEX[t * HEAT_RH_COUNT + rh_next], rh_frac, HEAT_RH_STEP * 10);
+	int high = lerp(HEAT_INDEX[t_next * HEAT_RH_COUNT + rh], HEAT_INDEX[t_next * HEAT_RH_COUNT + rh_next], rh_frac, HEAT_RH_STEP * 10);
+	int index = lerp(low, high, t_frac, HEAT_TEMP_STEP * 10);
+
+	// back to tenths of a degree celsius, rounding to nearest
+	int celsius = (index - 320) * 5;
+	return (celsius + ((celsius < 0) ? -4 : 4)) / 9;
+}
@@ -0,0 +1,31 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _DERIVED_H
+#define _DERIVED_H
+
+#include "pico/stdlib.h"
+
+// Quantities derived from temperature and humidity, computed from the
+// integer tables generated by tools/gen_tables.py
+
+/*
+ *	Returns the dew point in tenths of a degree celsius (Magnus formula)
+ *
+ *	Temperatures are clamped to -40 to 80 C and humidity to 1 to 100 %.
+ */
+int derived_dew_point(int temp_tenths, uint humidity_tenths);
+
+/*
+ *	Returns the NWS heat index in tenths of a degree celsius
+ *
+ *	Below 40 F the heat index is taken to be the temperature itself. Within a
+ *	few tenths of the float formula, except where the formula itself jumps
+ *	from its simple form to the Rothfusz regression around 80 F.
+ */
+int derived_heat_index(int temp_tenths, uint humidity_tenths);
+
+#endif
@@ -0,0 +1,237 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdio.h>
+#include "dht.h"
+#include "dht_backend.h"
+#include "profile.h"
+#include "hardware/sync.h"
+
+_Static_assert(DHT_DIAG_POSITIONS == DHT_PULSE_COUNT, "a frame times out with at most DHT_PULSE_COUNT - 1 pulses captured");
+
+// Read state of one sensor, shared between the request and the IRQ handlers
+typedef struct {
+	volatile dht_state state;
+	dht_callback done;
+	uint retries;
+	bool started;
+	absolute_time_t last_start;
+	alarm_id_t alarm;
+	dht_reading result;
+	dht_diag diag;
+#if PROFILE
+	uint32_t profile_start;
+#endif
+} dht_sensor;
+
+static dht_sensor sensors[DHT_MAX_SENSORS];
+static uint sensor_count = 0;
+
+void dht_attempt(uint sensor);
+
+int64_t dht_retry_callback(alarm_id_t id, void *user_data) {
+	uint sensor = (uint)(uintptr_t)user_data;
+	sensors[sensor].alarm = 0;
+	dht_attempt(sensor);
+	return 0;
+}
+
+/*
+ *	Ends an attempt, retrying it after the re-read window if it failed
+ */
+void dht_complete(uint sensor, dht_status status) {
+	dht_sensor *s = &sensors[sensor];
+	if (s->alarm) {
+		cancel_alarm(s->alarm);
+		s->alarm = 0;
+	}
+	dht_backend_stop(sensor);
+#if PROFILE
+	profile_record(PROFILE_READ, s->profile_start);
+#endif
+
+	if (status == DHT_OK) {
+		++s->diag.ok;
+	} else if (status == DHT_CHECKSUM) {
+		++s->diag.checksums;
+	}
+
+	if (status != DHT_OK && s->retries < DHT_MAX_RETRIES) {
+		++s->retries;
+		++s->diag.retries;
+		s->state = DHT_STATE_RETRY;
+		s->alarm = add_alarm_at(delayed_by_ms(s->last_start, DHT_MIN_INTERVAL_MS), dht_retry_callback, (void *)(uintptr_t)sensor, true);
+		return;
+	}
+
+	if (status != DHT_OK) {
+		++s->diag.failures;
+	}
+	s->state = DHT_STATE_IDLE;
+	s->done(sensor, status, &s->result);
+}
+
+int64_t dht_timeout_callback(alarm_id_t id, void *user_data) {
+	uint sensor = (uint)(uintptr_t)user_data;
+	sensors[sensor].alarm = 0;
+	uint16_t *timeouts = &sensors[sensor].diag.timeouts[MIN(dht_backend_captured(sensor), DHT_DIAG_POSITIONS - 1)];
+	if (*timeouts < UINT16_MAX) {
+		++*timeouts;
+	}
+	dht_complete(sensor, DHT_TIMEOUT);
+	return 0;
+}
+
+void dht_on_released(uint sensor) {
+	if (sensors[sensor].state == DHT_STATE_START) {
+		sensors[sensor].state = DHT_STATE_RESPONSE;
+	}
+}
+
+void __not_in_flash_func(dht_on_preamble)(uint sensor) {
+	dht_state state = sensors[sensor].state;
+	if (state == DHT_STATE_START || state == DHT_STATE_RESPONSE) {
+		sensors[sensor].state = DHT_STATE_CAPTURE;
+	}
+}
+
+void dht_on_frame(uint sensor) {
+	if (sensors[sensor].state == DHT_STATE_CAPTURE) {
+		sensors[sensor].state = DHT_STATE_VALIDATE;
+		dht_model_quality(sensor, &sensors[sensor].diag);
+		PROFILE_ENTER(PROFILE_DECODE);
+		dht_status status = dht_model_decode(sensor, &sensors[sensor].result);
+		PROFILE_EXIT(PROFILE_DECODE);
+		dht_complete(sensor, status);
+	}
+}
+
+/*
+ *	Starts one attempt with a fresh start pulse
+ */
+void dht_attempt(uint sensor) {
+	dht_sensor *s = &sensors[sensor];
+	s->started = true;
+	s->last_start = get_absolute_time();
+#if PROFILE
+	s->profile_start = profile_now();
+#endif
+	s->state = DHT_STATE_START;
+	++s->diag.attempts;
+
+	s->alarm = add_alarm_in_ms(DHT_READ_TIME_MS, dht_timeout_callback, (void *)(uintptr_t)sensor, true);
+	dht_backend_start(sensor);
+}
+
+void dht_init(const uint *pins, uint count) {
+	sensor_count = MIN(count, DHT_SENSOR_COUNT);
+	for (uint i = 0; i < sensor_count; ++i) {
+		sensors[i].diag.min_margin_us = UINT8_MAX;
+	}
+	dht_backend_init(pins, sensor_count);
+}
+
+void dht_clock_changed() {
+	dht_backend_clock_changed();
+}
+
+uint32_t dht_rate_hz() {
+	return dht_backend_rate_hz();
+}
+
+uint dht_sensor_count() {
+	return sensor_count;
+}
+
+dht_status dht_request(uint sensor, dht_callback callback) {
+	dht_sensor *s = &sensors[sensor];
+	if (s->state != DHT_STATE_IDLE) {
+		return DHT_BUSY;
+	}
+	if (s->started && absolute_time_diff_us(s->last_start, get_absolute_time()) < DHT_MIN_INTERVAL_MS * 1000ll) {
+		return DHT_TOO_SOON;
+	}
+
+	s->done = callback;
+	s->retries = 0;
+	dht_attempt(sensor);
+	return DHT_OK;
+}
+
+uint dht_request_all(dht_callback callback) {
+	uint started = 0;
+	for (uint i = 0; i < sensor_count; ++i) {
+		if (dht_request(i, callback) == DHT_OK) {
+			++started;
+		}
+	}
+	return started;
+}
+
+absolute_time_t dht_next_read_time(uint sensor) {
+	const dht_sensor *s = &sensors[sensor];
+	return s->started ? delayed_by_ms(s->last_start, DHT_MIN_INTERVAL_MS) : get_absolute_time();
+}
+
+dht_state dht_get_state(uint sensor) {
+	return sensors[sensor].state;
+}
+
+void dht_get_diag(uint sensor, dht_diag *diag) {
+	// the counters move in IRQ context
+	uint32_t status = save_and_disable_interrupts();
+	*diag = sensors[sensor].diag;
+	restore_interrupts(status);
+}
+
+void dht_dump_diag(uint sensor) {
+	dht_diag diag;
+	dht_get_diag(sensor, &diag);
+	printf("sensor %u: %lu attempts, %lu ok, %lu checksum, %lu retries, %lu failed", sensor,
+		(unsigned long)diag.attempts, (unsigned long)diag.ok, (unsigned long)diag.checksums,
+		(unsigned long)diag.retries, (unsigned long)diag.failures);
+	printf("\n  timeouts by pulses captured:");
+	for (uint i = 0; i < DHT_DIAG_POSITIONS; ++i) {
+		if (diag.timeouts[i]) {
+			printf(" %u:%u", i, diag.timeouts[i]);
+		}
+	}
+#if !SENSOR_SHT3X
+	printf("\n  margin %u us, lowest %u us; widths by us:", diag.last_margin_us, diag.min_margin_us);
+	for (uint i = 0; i < DHT_DIAG_BINS; ++i) {
+		if (diag.widths[i]) {
+			printf(" %u:%u", i * DHT_DIAG_BIN_US, diag.widths[i]);
+		}
+	}
+#endif
+	printf("\n");
+}
+
+// Result handed from the callback to the blocking read
+static volatile bool blocking_done;
+static dht_status blocking_status;
+
+void dht_blocking_callback(uint sensor, dht_status status, const dht_reading *reading) {
+	blocking_status = status;
+	blocking_done = true;
+}
+
+dht_status read_from_dht(uint sensor, dht_reading *result) {
+	blocking_done = false;
+	dht_status status = dht_request(sensor, dht_blocking_callback);
+	if (status != DHT_OK) {
+		return status;
+	}
+
+	while (!blocking_done) {
+		__wfe();
+	}
+
+	if (blocking_status == DHT_OK) {
+		*result = sensors[sensor].result;
+	}
+	return blocking_status;
+}
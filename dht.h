@@ -0,0 +1,208 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _DHT_H
+#define _DHT_H
+
+#include "pico/stdlib.h"
+
+// Driver for the temperature and humidity sensors, whichever model
+// THERMOMETER_SENSOR selects: dht.c runs the reads and retries of every
+// model, over the one-wire capture backend for a DHT11 or DHT22 and over
+// I2C for an SHT3x, and the model's source file decodes its frames
+
+// Sensor reading result, in fixed point
+typedef struct {
+	uint16_t humidity_tenths;  // tenths of a percent
+	int16_t temp_tenths;       // tenths of a degree celsius
+} dht_reading;
+
+/*
+ *	Converts tenths of a degree celsius to tenths of a degree fahrenheit
+ */
+static inline int dht_celsius_to_fahrenheit(int tenths) {
+	return (tenths * 9) / 5 + 320;
+}
+
+/*
+ *	Optional float accessors; they pull in soft-float only where used
+ */
+static inline float dht_humidity(const dht_reading *reading) {
+	return reading->humidity_tenths / 10.0f;
+}
+
+static inline float dht_temp_celsius(const dht_reading *reading) {
+	return reading->temp_tenths / 10.0f;
+}
+
+#if SENSOR_SHT3X
+#define DHT_MODEL_NAME "SHT3x"
+
+// Time a read attempt takes to fetch the latest measurement at 400 kHz,
+// with room to wait for another sensor on the same bus
+#define DHT_READ_TIME_MS 5
+
+// The sensor measures at 10 Hz, so reads closer than this repeat a measurement
+#define DHT_MIN_INTERVAL_MS 100
+#else
+#if SENSOR_DHT22
+#define DHT_MODEL_NAME "DHT22"
+#else
+#define DHT_MODEL_NAME "DHT11"
+#endif
+
+// Time a read attempt takes from its start pulse until the frame is complete
+#define DHT_READ_TIME_MS 30
+
+// The sensor needs this long between the starts of two reads
+#define DHT_MIN_INTERVAL_MS 2000
+#endif
+
+// Extra attempts made after a failed read before giving up
+#define DHT_MAX_RETRIES 2
+
+// Most sensors that can be attached at once
+#define DHT_MAX_SENSORS 8
+
+// Sensors this build is configured for, the length of DHT_PINS; buffers
+// handed out from the arena are sized for this many
+#ifndef DHT_SENSOR_COUNT
+#define DHT_SENSOR_COUNT DHT_MAX_SENSORS
+#endif
+
+// Result of a read
+typedef enum {
+	DHT_OK,
+	DHT_BUSY,      // a read is already in progress
+	DHT_TIMEOUT,   // the sensor stopped responding mid-frame, or never answered
+	DHT_CHECKSUM,  // the frame arrived but failed its checksum
+	DHT_TOO_SOON,  // the last read started less than DHT_MIN_INTERVAL_MS ago
+} dht_status;
+
+// Bins of the pulse width histograms, DHT_DIAG_BIN_US microseconds each;
+// the last also takes every longer pulse
+#define DHT_DIAG_BINS 16
+#define DHT_DIAG_BIN_US 8
+
+// Points a one-wire frame can time out at: with 0 pulses captured, when the
+// sensor never answered, up to the preamble and 39 data bits
+#define DHT_DIAG_POSITIONS 41
+
+// Signal quality of one sensor since boot, to spot a failing cable or sensor
+// before its reads stop altogether. The pulse widths and margins are of the
+// one-wire frames, and stay 0 for an SHT3x.
+typedef struct {
+	uint32_t attempts;   // attempts started, retries included
+	uint32_t ok;         // attempts that decoded
+	uint32_t checksums;  // frames that failed their checksum
+	uint32_t retries;    // attempts made after a failed one
+	uint32_t failures;   // reads that ran out of retries
+	uint16_t timeouts[DHT_DIAG_POSITIONS];  // attempts that timed out, by the pulses they had captured
+	uint16_t widths[DHT_DIAG_BINS];         // data bit high pulses, all halved whenever a bin would overflow
+	uint8_t last_margin_us;  // closest a data bit of the last frame came to the bit threshold
+	uint8_t min_margin_us;   // closest a data bit of any frame came, 255 before the first
+} dht_diag;
+
+// Driver state; each step is advanced by the capture backend's IRQs or a timer
+typedef enum {
+	DHT_STATE_IDLE,
+	DHT_STATE_START,     // holding the start pulse
+	DHT_STATE_RESPONSE,  // line released, waiting for the response preamble
+	DHT_STATE_CAPTURE,   // collecting the 40 data bits
+	DHT_STATE_VALIDATE,  // frame complete, checking and converting it
+	DHT_STATE_RETRY,     // waiting out the re-read window before another attempt
+} dht_state;
+
+/*
+ *	Called from IRQ context once a sensor's read succeeds or runs out of retries
+ *
+ *	`reading` is only valid when `status` is DHT_OK.
+ */
+typedef void (*dht_callback)(uint sensor, dht_status status, const dht_reading *reading);
+
+/*
+ *	Claims the capture backend's hardware for `count` sensors, sensor i on `pins[i]`
+ */
+void dht_init(const uint *pins, uint count);
+
+// Rate the capture backend has to run at whatever clk_sys is: pulses are
+// timed in microseconds, and an SHT3x bus runs at 400 kHz
+#if SENSOR_SHT3X
+#define DHT_RATE_HZ 400000
+#else
+#define DHT_RATE_HZ 1000000
+#endif
+
+/*
+ *	Returns the rate the capture backend actually runs at from the current clk_sys, to check against DHT_RATE_HZ
+ */
+uint32_t dht_rate_hz();
+
+/*
+ *	Returns the number of sensors passed to dht_init, at most DHT_SENSOR_COUNT
+ */
+uint dht_sensor_count();
+
+/*
+ *	Starts a read of one sensor in the background, retrying failures up to DHT_MAX_RETRIES times
+ *
+ *	Returns DHT_OK if the read was started, in which case `callback` is
+ *	called with the final result. Returns DHT_BUSY or DHT_TOO_SOON without
+ *	calling it otherwise.
+ */
+dht_status dht_request(uint sensor, dht_callback callback);
+
+/*
+ *	Starts reads of every sensor at once, so a sweep takes as long as one read
+ *
+ *	Returns the number of sensors that were started.
+ */
+uint dht_request_all(dht_callback callback);
+
+/*
+ *	Returns the earliest time dht_request will start a new read of `sensor`
+ */
+absolute_time_t dht_next_read_time(uint sensor);
+
+/*
+ *	Returns the current state of a sensor's read
+ */
+dht_state dht_get_state(uint sensor);
+
+/*
+ *	Retunes the capture backend after clk_sys has changed
+ *
+ *	A read in progress across the change is likely to fail its checksum.
+ */
+void dht_clock_changed();
+
+/*
+ *	Copies a sensor's signal quality counters into `diag`
+ */
+void dht_get_diag(uint sensor, dht_diag *diag);
+
+/*
+ *	Prints a sensor's signal quality counters over stdio
+ */
+void dht_dump_diag(uint sensor);
+
+#if !SENSOR_SHT3X
+/*
+ *	Prints a sensor's last captured pulse widths over stdio, with what they decode to
+ *
+ *	The line is in the format of the recorded traces the host tests replay.
+ */
+void dht_dump_pulses(uint sensor);
+#endif
+
+/*
+ *	Blocking read of one sensor: requests a read and sleeps until it finishes
+ *
+ *	`result` is only written when DHT_OK is returned.
+ */
+dht_status read_from_dht(uint sensor, dht_reading *result);
+
+#endif
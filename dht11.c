@@ -0,0 +1,25 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "dht_backend.h"
+
+/*
+ *	A DHT11 frame holds whole units in the first byte of each quantity and
+ *	tenths in the second; humidity tenths are always 0, and the temperature's
+ *	second byte carries the sign in its top bit
+ */
+dht_status dht_model_decode(uint sensor, dht_reading *result) {
+	uint8_t data[5];
+	dht_status status = dht_frame_bytes(dht_pulses[sensor], data);
+	if (status != DHT_OK) {
+		return status;
+	}
+
+	int temp = data[2] * 10 + (data[3] & 0x0f);
+	result->humidity_tenths = data[0] * 10 + data[1];
+	result->temp_tenths = (data[3] & 0x80) ? -temp : temp;
+	return DHT_OK;
+}
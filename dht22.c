@@ -0,0 +1,24 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "dht_backend.h"
+
+/*
+ *	A DHT22 (or AM2302) frame holds each quantity in tenths as a 16-bit word,
+ *	with the temperature in sign and magnitude
+ */
+dht_status dht_model_decode(uint sensor, dht_reading *result) {
+	uint8_t data[5];
+	dht_status status = dht_frame_bytes(dht_pulses[sensor], data);
+	if (status != DHT_OK) {
+		return status;
+	}
+
+	int temp = ((data[2] & 0x7f) << 8) | data[3];
+	result->humidity_tenths = (data[0] << 8) | data[1];
+	result->temp_tenths = (data[2] & 0x80) ? -temp : temp;
+	return DHT_OK;
+}
@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _DHT_BACKEND_H
+#define _DHT_BACKEND_H
+
+#include "dht.h"
+
+// Interface between the DHT state machine in dht.c, the capture backend
+// selected by THERMOMETER_DHT_BACKEND (dht_pio.c or dht_irq.c) and the
+// sensor model selected by THERMOMETER_SENSOR (dht11.c or dht22.c); sht3x.c
+// is both the backend and the model of an SHT3x
+
+// Start pulse that wakes the sensor: at least 18 ms for a DHT11, 1 ms for a DHT22
+#if SENSOR_DHT22
+#define DHT_START_PULSE_US 1100
+#else
+#define DHT_START_PULSE_US 18000
+#endif
+
+// High pulses per frame: the response preamble followed by 40 data bits
+#define DHT_PULSE_COUNT 41
+
+// Widths of each sensor's captured high pulses in microseconds, filled by the backend
+extern uint32_t dht_pulses[DHT_MAX_SENSORS][DHT_PULSE_COUNT];
+
+/*
+ *	Claims the backend's hardware for `count` sensors, sensor i on `pins[i]`
+ */
+void dht_backend_init(const uint *pins, uint count);
+
+/*
+ *	Sends a sensor's start pulse and starts capturing its pulses into dht_pulses
+ */
+void dht_backend_start(uint sensor);
+
+/*
+ *	Stops any capture in progress on a sensor and releases its line
+ */
+void dht_backend_stop(uint sensor);
+
+/*
+ *	Returns how many pulses of the frame in progress have been captured, for the timeout counters
+ *
+ *	Called before dht_backend_stop.
+ */
+uint dht_backend_captured(uint sensor);
+
+/*
+ *	Returns the rate the backend's dividers give at the current clk_sys, for dht_rate_hz
+ */
+uint32_t dht_backend_rate_hz();
+
+/*
+ *	Retunes any clock dividers after clk_sys has changed; no read is in progress
+ */
+void dht_backend_clock_changed();
+
+/*
+ *	Decodes the frame just captured for a sensor into `result`, implemented by the sensor model
+ */
+dht_status dht_model_decode(uint sensor, dht_reading *result);
+
+/*
+ *	Adds the frame just captured for a sensor to its pulse width histogram and margins
+ *
+ *	Implemented by dht_frame.c for the one-wire models, and by sht3x.c.
+ */
+void dht_model_quality(uint sensor, dht_diag *diag);
+
+/*
+ *	Returns the high pulse width above which a data bit of a one-wire frame is a 1
+ *
+ *	Every frame starts with an 80 us preamble, so the 48 us threshold is
+ *	scaled by the preamble as captured: whatever the capture counts in, at
+ *	any clk_sys and through divider rounding or a sensor that runs slow,
+ *	the data bits are measured in the same units. A preamble more than 4
+ *	times off is no preamble, and leaves the threshold at 48.
+ */
+uint dht_frame_threshold(const uint32_t *pulses);
+
+/*
+ *	Slices a one-wire frame of captured pulse widths into its 5 bytes and checks the checksum
+ */
+dht_status dht_frame_bytes(const uint32_t *pulses, uint8_t *data);
+
+/*
+ *	Called by the backend from IRQ context as a sensor's frame arrives: once
+ *	the start pulse has been released, once the preamble has been captured and
+ *	once all DHT_PULSE_COUNT pulses have been captured
+ */
+void dht_on_released(uint sensor);
+void dht_on_preamble(uint sensor);
+void dht_on_frame(uint sensor);
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdio.h>
+#include "dht_backend.h"
+
+// A data bit is a 26-28 us high pulse for 0 and 70 us for 1, after an
+// 80 us response preamble
+static const uint BIT_THRESHOLD_US = 48;
+static const uint PREAMBLE_US = 80;
+
+// Preambles further than this factor from PREAMBLE_US are not trusted to
+// calibrate the threshold
+static const uint PREAMBLE_TOLERANCE = 4;
+
+uint32_t dht_pulses[DHT_MAX_SENSORS][DHT_PULSE_COUNT];
+
+uint dht_frame_threshold(const uint32_t *pulses) {
+	uint32_t preamble = pulses[0];
+	if (preamble < PREAMBLE_US / PREAMBLE_TOLERANCE || preamble > PREAMBLE_US * PREAMBLE_TOLERANCE) {
+		return BIT_THRESHOLD_US;
+	}
+	return (preamble * BIT_THRESHOLD_US + PREAMBLE_US / 2) / PREAMBLE_US;
+}
+
+void dht_model_quality(uint sensor, dht_diag *diag) {
+	uint threshold = dht_frame_threshold(dht_pulses[sensor]);
+	uint margin = UINT8_MAX;
+	for (uint i = 1; i < DHT_PULSE_COUNT; ++i) {
+		uint width = dht_pulses[sensor][i];
+		uint bin = MIN(width / DHT_DIAG_BIN_US, DHT_DIAG_BINS - 1);
+		if (diag->widths[bin] == UINT16_MAX) {
+			// scaling every bin down keeps the shape of the histogram
+			for (uint j = 0; j < DHT_DIAG_BINS; ++j) {
+				diag->widths[j] /= 2;
+			}
+		}
+		++diag->widths[bin];
+		margin = MIN(margin, (width > threshold) ? width - threshold : threshold - width);
+	}
+	diag->last_margin_us = margin;
+	diag->min_margin_us = MIN(diag->min_margin_us, margin);
+}
+
+dht_status dht_frame_bytes(const uint32_t *pulses, uint8_t *data) {
+	// decode the data bits against the threshold the preamble calibrates
+	uint threshold = dht_frame_threshold(pulses);
+	for (uint i = 0; i < 5; ++i) {
+		data[i] = 0;
+	}
+	for (uint i = 0; i < 40; ++i) {
+		uint width = pulses[i + 1];
+		data[i / 8] <<= 1;
+		if (width > threshold) data[i / 8] |= 1;
+	}
+
+	if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF)) {
+		return DHT_CHECKSUM;
+	}
+	return DHT_OK;
+}
+
+void dht_dump_pulses(uint sensor) {
+	dht_reading reading = {0, 0};
+	dht_status status = dht_model_decode(sensor, &reading);
+	printf("%s %u %d", (status == DHT_OK) ? "ok" : "checksum", reading.humidity_tenths, reading.temp_tenths);
+	for (uint i = 0; i < DHT_PULSE_COUNT; ++i) {
+		printf(" %lu", (unsigned long)dht_pulses[sensor][i]);
+	}
+	printf("\n");
+}
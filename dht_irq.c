@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "dht_backend.h"
+#include "profile.h"
+#include "hardware/irq.h"
+
+// GPIO IRQ capture backend for boards without free PIO state machines: an
+// edge interrupt timestamps every transition on each sensor's line and the
+// widths are worked out once the frame is complete
+
+// Edges after the sensor's response low: a rise and fall per high pulse
+#define EDGE_COUNT (DHT_PULSE_COUNT * 2)
+
+// Capture state of one sensor
+typedef struct {
+	uint pin;
+	alarm_id_t release_alarm;
+
+	// edge timestamps in microseconds
+	uint32_t edges[EDGE_COUNT];
+	volatile uint edge_count;
+
+	// set once the sensor pulls the line low to answer the start pulse
+	volatile bool armed;
+} dht_channel;
+
+static dht_channel channels[DHT_MAX_SENSORS];
+static uint channel_count = 0;
+
+/*
+ *	Records one edge of a sensor's line seen at time `now`
+ */
+void __not_in_flash_func(dht_gpio_edge)(uint sensor, uint32_t now, uint32_t events) {
+	dht_channel *ch = &channels[sensor];
+
+	// ignore the pull-up bringing the line high before the sensor answers
+	if (!ch->armed) {
+		ch->armed = (events & GPIO_IRQ_EDGE_FALL) != 0;
+		return;
+	}
+
+	if (ch->edge_count < EDGE_COUNT) {
+		ch->edges[ch->edge_count++] = now;
+	}
+
+	if (ch->edge_count == 2) {
+		dht_on_preamble(sensor);
+	} else if (ch->edge_count == EDGE_COUNT) {
+		gpio_set_irq_enabled(ch->pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
+		for (uint i = 0; i < DHT_PULSE_COUNT; ++i) {
+			dht_pulses[sensor][i] = ch->edges[i * 2 + 1] - ch->edges[i * 2];
+		}
+		dht_on_frame(sensor);
+	}
+}
+
+/*
+ *	GPIO IRQ: timestamps whatever edges the sensors' lines have seen
+ *
+ *	Runs from SRAM, so an XIP cache miss cannot come between an edge and
+ *	its timestamp.
+ */
+void __not_in_flash_func(dht_gpio_irq)() {
+	uint32_t now = time_us_32();
+	for (uint i = 0; i < channel_count; ++i) {
+		uint32_t events = gpio_get_irq_event_mask(channels[i].pin) & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+		if (events) {
+			gpio_acknowledge_irq(channels[i].pin, events);
+			PROFILE_ENTER(PROFILE_CAPTURE_IRQ);
+			dht_gpio_edge(i, now, events);
+			PROFILE_EXIT(PROFILE_CAPTURE_IRQ);
+		}
+	}
+}
+
+int64_t dht_release_callback(alarm_id_t id, void *user_data) {
+	uint sensor = (uint)(uintptr_t)user_data;
+	dht_channel *ch = &channels[sensor];
+	ch->release_alarm = 0;
+
+	// listen for the response before letting go of the line
+	ch->edge_count = 0;
+	ch->armed = false;
+	gpio_acknowledge_irq(ch->pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL);
+	gpio_set_irq_enabled(ch->pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+	gpio_set_dir(ch->pin, GPIO_IN);
+
+	dht_on_released(sensor);
+	return 0;
+}
+
+void dht_backend_init(const uint *pins, uint count) {
+	uint32_t mask = 0;
+	for (uint i = 0; i < count; ++i) {
+		channels[i].pin = pins[i];
+		gpio_init(pins[i]);
+		gpio_pull_up(pins[i]);
+		gpio_put(pins[i], 0);
+		mask |= 1u << pins[i];
+	}
+	channel_count = count;
+
+	// one handler serves every sensor's line
+	gpio_add_raw_irq_handler_masked(mask, dht_gpio_irq);
+	irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+void dht_backend_start(uint sensor) {
+	dht_channel *ch = &channels[sensor];
+
+	// the line only ever outputs low; the pull-up supplies the high level
+	gpio_set_dir(ch->pin, GPIO_OUT);
+	ch->release_alarm = add_alarm_in_us(DHT_START_PULSE_US, dht_release_callback, (void *)(uintptr_t)sensor, true);
+}
+
+void dht_backend_stop(uint sensor) {
+	dht_channel *ch = &channels[sensor];
+	if (ch->release_alarm) {
+		cancel_alarm(ch->release_alarm);
+		ch->release_alarm = 0;
+	}
+	gpio_set_irq_enabled(ch->pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
+	gpio_set_dir(ch->pin, GPIO_IN);
+}
+
+uint dht_backend_captured(uint sensor) {
+	// a pulse is captured once its falling edge is
+	return channels[sensor].edge_count / 2;
+}
+
+uint32_t dht_backend_rate_hz() {
+	// the timer ticks at 1 MHz whatever clk_sys is
+	return 1000000;
+}
+
+void dht_backend_clock_changed() {
+	// edges are timestamped by the timer, which runs from clk_ref
+}
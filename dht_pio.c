@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "dht_backend.h"
+#include "profile.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "dht.pio.h"
+
+// PIO capture backend: one state machine per sensor times each pulse and a
+// DMA channel per sensor moves the widths into dht_pulses. Sensors fill pio0
+// first and then pio1, unless the display scanner is there: its program
+// leaves too little of pio1's instruction memory for this one, so with the
+// PIO display there are only pio0's four state machines.
+
+#if DISPLAY_PIO && DHT_SENSOR_COUNT > 4
+#error "The PIO display leaves room for 4 sensors with the PIO capture backend; use the irq backend for more"
+#endif
+
+// Capture hardware of one sensor
+typedef struct {
+	PIO pio;
+	uint sm;
+	uint offset;
+	uint pin;
+	uint dma;
+
+	// set once the DMA channel has moved on from the preamble to the data bits
+	bool capturing_frame;
+} dht_channel;
+
+static dht_channel channels[DHT_MAX_SENSORS];
+static uint channel_count = 0;
+
+// Program offset in each PIO block, or -1 if it has not been loaded yet
+static int program_offsets[2] = {-1, -1};
+
+/*
+ *	Arms a sensor's DMA channel to move `count` pulses into dht_pulses from `index` on
+ */
+void __not_in_flash_func(dht_capture)(uint sensor, uint index, uint count) {
+	dht_channel *ch = &channels[sensor];
+	dma_channel_config c = dma_channel_get_default_config(ch->dma);
+	channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+	channel_config_set_read_increment(&c, false);
+	channel_config_set_write_increment(&c, true);
+	channel_config_set_dreq(&c, pio_get_dreq(ch->pio, ch->sm, false));
+	dma_channel_configure(ch->dma, &c, &dht_pulses[sensor][index], &ch->pio->rxf[ch->sm], count, true);
+}
+
+/*
+ *	PIO IRQ: a start pulse has ended and the line is released
+ */
+void dht_pio_irq() {
+	for (uint i = 0; i < channel_count; ++i) {
+		dht_channel *ch = &channels[i];
+		if (pio_interrupt_get(ch->pio, ch->sm)) {
+			pio_interrupt_clear(ch->pio, ch->sm);
+			dht_on_released(i);
+		}
+	}
+}
+
+/*
+ *	DMA IRQ: a preamble or a frame's data bits have been captured
+ *
+ *	Runs from SRAM, as the data bits start arriving in the state machine's
+ *	FIFO while the channel is still being re-armed.
+ */
+void __not_in_flash_func(dht_dma_irq)() {
+	for (uint i = 0; i < channel_count; ++i) {
+		dht_channel *ch = &channels[i];
+		if (!dma_channel_get_irq0_status(ch->dma)) {
+			continue;
+		}
+		dma_channel_acknowledge_irq0(ch->dma);
+		PROFILE_ENTER(PROFILE_CAPTURE_IRQ);
+
+		if (!ch->capturing_frame) {
+			// preamble received, collect the data bits
+			ch->capturing_frame = true;
+			dht_capture(i, 1, DHT_PULSE_COUNT - 1);
+			dht_on_preamble(i);
+		} else {
+			dht_on_frame(i);
+		}
+		PROFILE_EXIT(PROFILE_CAPTURE_IRQ);
+	}
+}
+
+/*
+ *	Claims a state machine in the first PIO block with one free, loading the program there if needed
+ */
+void dht_claim_sm(dht_channel *ch) {
+	PIO blocks[] = {pio0, pio1};
+	for (uint i = 0; i < 2; ++i) {
+		int sm = pio_claim_unused_sm(blocks[i], false);
+		if (sm < 0) {
+			continue;
+		}
+		if (program_offsets[i] < 0) {
+			if (!pio_can_add_program(blocks[i], &dht_program)) {
+				pio_sm_unclaim(blocks[i], sm);
+				continue;
+			}
+			program_offsets[i] = pio_add_program(blocks[i], &dht_program);
+
+			// the rest of a read is driven by this block's IRQ
+			uint irq = (blocks[i] == pio0) ? PIO0_IRQ_0 : PIO1_IRQ_0;
+			irq_add_shared_handler(irq, dht_pio_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+			irq_set_enabled(irq, true);
+		}
+		ch->pio = blocks[i];
+		ch->sm = sm;
+		ch->offset = program_offsets[i];
+		return;
+	}
+	panic("No free PIO state machine for DHT sensor");
+}
+
+void dht_backend_init(const uint *pins, uint count) {
+	for (uint i = 0; i < count; ++i) {
+		dht_channel *ch = &channels[i];
+		ch->pin = pins[i];
+		dht_claim_sm(ch);
+		dht_program_init(ch->pio, ch->sm, ch->offset, ch->pin);
+		pio_set_irq0_source_enabled(ch->pio, pis_interrupt0 + ch->sm, true);
+
+		ch->dma = dma_claim_unused_channel(true);
+		dma_channel_set_irq0_enabled(ch->dma, true);
+	}
+	channel_count = count;
+
+	irq_add_shared_handler(DMA_IRQ_0, dht_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+	irq_set_enabled(DMA_IRQ_0, true);
+}
+
+void dht_backend_start(uint sensor) {
+	dht_channel *ch = &channels[sensor];
+
+	// rewind the state machine to the start pulse
+	pio_sm_set_enabled(ch->pio, ch->sm, false);
+	pio_sm_clear_fifos(ch->pio, ch->sm);
+	pio_sm_restart(ch->pio, ch->sm);
+	pio_sm_exec(ch->pio, ch->sm, pio_encode_jmp(ch->offset));
+
+	ch->capturing_frame = false;
+	dht_capture(sensor, 0, 1);
+	pio_sm_put(ch->pio, ch->sm, DHT_START_PULSE_US);
+	pio_sm_set_enabled(ch->pio, ch->sm, true);
+}
+
+uint dht_backend_captured(uint sensor) {
+	dht_channel *ch = &channels[sensor];
+	if (!ch->capturing_frame) {
+		return 0;
+	}
+	return DHT_PULSE_COUNT - dma_channel_hw_addr(ch->dma)->transfer_count;
+}
+
+uint32_t dht_backend_rate_hz() {
+	if (channel_count == 0) {
+		return DHT_RATE_HZ;
+	}
+
+	// every state machine has the same 16.8 fixed point divider, and the
+	// measure loop takes two cycles a count
+	const dht_channel *ch = &channels[0];
+	uint32_t divider = ch->pio->sm[ch->sm].clkdiv >> PIO_SM0_CLKDIV_FRAC_LSB;
+	return (uint64_t)clock_get_hz(clk_sys) * 256 / divider / 2;
+}
+
+void dht_backend_clock_changed() {
+	for (uint i = 0; i < channel_count; ++i) {
+		pio_sm_set_clkdiv(channels[i].pio, channels[i].sm, (float)clock_get_hz(clk_sys) / 2000000);
+	}
+}
+
+void dht_backend_stop(uint sensor) {
+	dht_channel *ch = &channels[sensor];
+	pio_sm_set_enabled(ch->pio, ch->sm, false);
+	pio_sm_set_consecutive_pindirs(ch->pio, ch->sm, ch->pin, 1, false);
+
+	// an abort can raise the channel's IRQ, which would look like a capture
+	// completing on a stopped sensor, so mask it meanwhile
+	dma_channel_set_irq0_enabled(ch->dma, false);
+	dma_channel_abort(ch->dma);
+	dma_channel_acknowledge_irq0(ch->dma);
+	dma_channel_set_irq0_enabled(ch->dma, true);
+}
@@ -0,0 +1,332 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <string.h>
+#include "pico/sync.h"
+#include "display.h"
+#include "profile.h"
+#if DISPLAY_PIO
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "display.pio.h"
+#else
+#include "hardware/structs/timer.h"
+#include "pico/multicore.h"
+#endif
+
+// Time each digit is scanned for; four digits give a 250 Hz refresh rate
+static const uint DIGIT_HOLD_US = 1000;
+
+// Time each digit is lit for at each brightness level, roughly even steps of
+// perceived brightness; the scan needs at least 3 us lit and 3 us dark
+static const uint16_t BRIGHTNESS_LIT_US[DISPLAY_BRIGHTNESS_LEVELS] = {
+	8, 20, 45, 90, 160, 270, 450, 997,
+};
+
+// A frame as the scanner reads it: the lit and dark times of every digit, each
+// less 3 us, and one byte of segments per digit
+typedef struct {
+	uint32_t duty;
+	uint32_t segments;
+} display_frame;
+
+// Frame the scanner reads; display_show publishes the back buffer to it with
+// a single store, so the scanner always sees a whole frame
+static volatile display_frame display_front __attribute__((aligned(8)));
+static uint display_brightness;
+
+// Two rings of the frame the scanner shows at each step, each with the frames
+// of its scroll's windows; a still display has the front frame at every step.
+// The scanner goes around display_shown's ring, and a new scroll is written to
+// the other ring, which the scanner takes at its next wrap, so a scroll always
+// starts from its first step and never tears the one before it. The rings are
+// aligned to their size so the PIO scanner's control channel can wrap around
+// them.
+static volatile display_frame *display_steps[2][DISPLAY_SCROLL_STEPS] __attribute__((aligned(DISPLAY_SCROLL_STEPS * sizeof(void *))));
+static volatile display_frame display_windows[2][DISPLAY_STRIP_MAX - 3] __attribute__((aligned(8)));
+static volatile uint display_shown = 0;
+static volatile bool display_shown_still = true;
+static volatile bool display_swap = false;
+static critical_section_t display_lock;
+static bool display_scrolling = false;
+
+_Static_assert((sizeof(display_steps[0]) & (sizeof(display_steps[0]) - 1)) == 0, "DISPLAY_SCROLL_STEPS must be a power of two");
+
+/*
+ *	Puts the front frame at every step of the shown ring, dropping any scroll
+ *	waiting for the scanner
+ */
+void display_still() {
+	critical_section_enter_blocking(&display_lock);
+	display_swap = false;
+	for (uint i = 0; i < DISPLAY_SCROLL_STEPS; ++i) {
+		display_steps[display_shown][i] = &display_front;
+	}
+	display_shown_still = true;
+	critical_section_exit(&display_lock);
+	display_scrolling = false;
+}
+
+/*
+ *	Moves the scanner on to the other ring if a scroll is waiting there and
+ *	the shown ring has just wrapped or is still
+ *
+ *	Called by the scanner as it goes from one step to the next. Returns
+ *	whether it swapped, in which case the scanner goes on from the first step
+ *	of display_shown's ring.
+ */
+bool __not_in_flash_func(display_take_swap)(bool wrapped) {
+	critical_section_enter_blocking(&display_lock);
+	bool take = display_swap && (wrapped || display_shown_still);
+	if (take) {
+		display_shown ^= 1;
+		display_shown_still = false;
+		display_swap = false;
+	}
+	critical_section_exit(&display_lock);
+	return take;
+}
+
+#if DISPLAY_PIO
+static PIO display_pio = pio1;
+static uint display_sm;
+static uint display_dma;
+static uint display_ctrl_dma;
+
+/*
+ *	Points the control channel at the other ring when the scanner takes it
+ *
+ *	Runs once a step, just after the control channel has started the data
+ *	channel on it, so the new ring's address is in place well before the
+ *	step's frames run out.
+ */
+void __not_in_flash_func(display_dma_irq)() {
+	dma_channel_acknowledge_irq1(display_ctrl_dma);
+	// the read address wraps back to the start of the ring after the last step
+	bool wrapped = dma_hw->ch[display_ctrl_dma].read_addr == (uintptr_t)display_steps[display_shown];
+	if (display_take_swap(wrapped)) {
+		dma_channel_set_read_addr(display_ctrl_dma, display_steps[display_shown], false);
+	}
+}
+
+void display_init(uint segment_pin, uint digit_pin) {
+	critical_section_init(&display_lock);
+	display_set_brightness(DISPLAY_BRIGHTNESS_LEVELS - 1);
+	display_still();
+
+	display_sm = pio_claim_unused_sm(display_pio, true);
+	uint offset = pio_add_program(display_pio, &display_program);
+	display_program_init(display_pio, display_sm, offset, segment_pin, digit_pin);
+
+	display_dma = dma_claim_unused_channel(true);
+	display_ctrl_dma = dma_claim_unused_channel(true);
+
+	// data channel feeds one step's frame to the PIO for DISPLAY_SCROLL_FRAMES
+	// frames, wrapping its read address around the 8-byte ring
+	dma_channel_config c = dma_channel_get_default_config(display_dma);
+	channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+	channel_config_set_read_increment(&c, true);
+	channel_config_set_write_increment(&c, false);
+	channel_config_set_ring(&c, false, 3);
+	channel_config_set_dreq(&c, pio_get_dreq(display_pio, display_sm, true));
+	channel_config_set_chain_to(&c, display_ctrl_dma);
+	dma_channel_configure(display_dma, &c, &display_pio->txf[display_sm], &display_front, 2 * DISPLAY_SCROLL_FRAMES, false);
+
+	// control channel restarts the data channel on the next step's frame
+	// whenever its count runs out, going around the steps; its count is
+	// always whole frames, so the PIO never loses track of which word is which
+	c = dma_channel_get_default_config(display_ctrl_dma);
+	channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+	channel_config_set_read_increment(&c, true);
+	channel_config_set_write_increment(&c, false);
+	channel_config_set_ring(&c, false, __builtin_ctz(sizeof(display_steps[0])));
+	dma_channel_configure(display_ctrl_dma, &c, &dma_hw->ch[display_dma].al3_read_addr_trig, display_steps[display_shown], 1, false);
+
+	// the capture backends share DMA_IRQ_0, so the ring swap has DMA_IRQ_1
+	dma_channel_set_irq1_enabled(display_ctrl_dma, true);
+	irq_set_exclusive_handler(DMA_IRQ_1, display_dma_irq);
+	irq_set_enabled(DMA_IRQ_1, true);
+
+	dma_channel_start(display_dma);
+	pio_sm_set_enabled(display_pio, display_sm, true);
+}
+
+void display_clock_changed() {
+	pio_sm_set_clkdiv(display_pio, display_sm, (float)clock_get_hz(clk_sys) / DISPLAY_RATE_HZ);
+}
+
+uint32_t display_rate_hz() {
+	// the divider is 16.8 fixed point
+	uint32_t divider = display_pio->sm[display_sm].clkdiv >> PIO_SM0_CLKDIV_FRAC_LSB;
+	return (uint64_t)clock_get_hz(clk_sys) * 256 / divider;
+}
+#else
+static uint display_segment_pin;
+static uint display_digit_pin;
+static uint32_t display_mask;
+
+/*
+ *	Display a single digit of the 7-segment display
+ *
+ *	Digit and segment pins are switched by a single masked write, so the
+ *	previous digit's segments never show on the next digit.
+ */
+void __not_in_flash_func(display_digit)(uint selector, uint8_t segments) {
+	PROFILE_ENTER(PROFILE_DISPLAY_DIGIT);
+	uint32_t digits = (0xfu & ~(1u << selector)) << display_digit_pin;
+	gpio_put_masked(display_mask, digits | ((uint32_t)segments << display_segment_pin));
+	PROFILE_EXIT(PROFILE_DISPLAY_DIGIT);
+}
+
+/*
+ *	Spins until the low word of the timer reaches `time_us`
+ *
+ *	Reads the timer itself rather than through the SDK's waits, which run
+ *	from flash.
+ */
+void __not_in_flash_func(display_wait_until)(uint32_t time_us) {
+	while ((int32_t)(timer_hw->timerawl - time_us) < 0) {
+		tight_loop_contents();
+	}
+}
+
+/*
+ *	Multiplexes the display forever on core 1
+ *
+ *	The loop and everything it calls between digits run from SRAM, so a cache
+ *	miss from core 0 cannot stretch a digit.
+ */
+void __not_in_flash_func(display_core1_entry)() {
+	// let core 0 park this core while it writes flash
+	multicore_lockout_victim_init();
+
+#if PROFILE
+	profile_init();
+#endif
+	uint32_t next = timer_hw->timerawl;
+	uint step = 0;
+	uint frames = 0;
+	while (1) {
+		// pick up the step's latest published frame at the frame boundary,
+		// moving on through the steps like the PIO scanner's DMA does
+		const volatile display_frame *frame = display_steps[display_shown][step];
+		uint32_t segments = frame->segments;
+		uint lit_us = (frame->duty & 0xffff) + 3;
+		for (uint i = 0; i < 4; ++i) {
+			display_digit(i, segments >> (i * 8));
+			display_wait_until(next + lit_us);
+			gpio_put_masked(display_mask, 0xfu << display_digit_pin);
+			next += DIGIT_HOLD_US;
+			display_wait_until(next);
+		}
+		if (++frames == DISPLAY_SCROLL_FRAMES) {
+			frames = 0;
+			step = (step + 1) % DISPLAY_SCROLL_STEPS;
+			if (display_take_swap(step == 0)) {
+				step = 0;
+			}
+		}
+	}
+}
+
+void display_init(uint segment_pin, uint digit_pin) {
+	critical_section_init(&display_lock);
+	display_set_brightness(DISPLAY_BRIGHTNESS_LEVELS - 1);
+	display_still();
+	display_segment_pin = segment_pin;
+	display_digit_pin = digit_pin;
+	display_mask = (0xffu << segment_pin) | (0xfu << digit_pin);
+
+	// segments start off (low) and digits start disabled (high)
+	gpio_init_mask(display_mask);
+	gpio_put_masked(display_mask, 0xfu << digit_pin);
+	gpio_set_dir_out_masked(display_mask);
+
+	multicore_launch_core1(display_core1_entry);
+}
+
+void display_clock_changed() {
+	// core 1 paces itself with the timer, which runs from clk_ref
+}
+
+uint32_t display_rate_hz() {
+	return 1000000;
+}
+#endif
+
+void display_show() {
+	display_front.segments = display_back_segments();
+	if (display_scrolling) {
+		display_still();
+	}
+}
+
+void display_scroll(const char *text) {
+	uint8_t strip[DISPLAY_STRIP_MAX];
+	uint length = display_render_strip(text, strip, DISPLAY_STRIP_MAX);
+	if (length <= 4) {
+		for (uint i = 0; i < 4; ++i) {
+			set_segments(i, (i < length) ? strip[i] : 0);
+		}
+		display_show();
+		return;
+	}
+
+	// write the ring the scanner is not on, dropping any scroll already
+	// waiting there
+	critical_section_enter_blocking(&display_lock);
+	display_swap = false;
+	uint ring = display_shown ^ 1;
+	critical_section_exit(&display_lock);
+
+	uint windows = length - 3;
+	for (uint i = 0; i < windows; ++i) {
+		uint32_t segments;
+		memcpy(&segments, &strip[i], sizeof(segments));
+		display_windows[ring][i].duty = display_front.duty;
+		display_windows[ring][i].segments = segments;
+	}
+
+	// the window moves a digit a step, waiting at the start for half the
+	// steps it does not take and at the end for the rest
+	uint wait = (DISPLAY_SCROLL_STEPS - (windows - 1)) / 2;
+	for (uint i = 0; i < DISPLAY_SCROLL_STEPS; ++i) {
+		uint window = (i < wait) ? 0 : MIN(i - wait + 1, windows - 1);
+		display_steps[ring][i] = &display_windows[ring][window];
+	}
+
+	// the scanner takes the new ring at the shown one's next wrap, or at its
+	// next step if the display is still
+	critical_section_enter_blocking(&display_lock);
+	display_swap = true;
+	critical_section_exit(&display_lock);
+	display_scrolling = true;
+}
+
+void display_set_brightness(uint level) {
+	display_brightness = MIN(level, DISPLAY_BRIGHTNESS_LEVELS - 1);
+	uint lit_us = BRIGHTNESS_LIT_US[display_brightness];
+	uint32_t duty = (lit_us - 3) | ((DIGIT_HOLD_US - lit_us - 3) << 16);
+	display_front.duty = duty;
+	for (uint ring = 0; ring < 2; ++ring) {
+		for (uint i = 0; i < count_of(display_windows[ring]); ++i) {
+			display_windows[ring][i].duty = duty;
+		}
+	}
+}
+
+uint display_get_brightness() {
+	return display_brightness;
+}
+
+void display_off() {
+	for (uint i = 0; i < 4; ++i) {
+		set_segments(i, 0);
+	}
+	display_show();
+}
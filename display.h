@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _DISPLAY_H
+#define _DISPLAY_H
+
+#include "pico/stdlib.h"
+
+// Segment bits of a packed digit, matching the order of the segment pins
+#define SEG_A (1u << 0)
+#define SEG_B (1u << 1)
+#define SEG_C (1u << 2)
+#define SEG_D (1u << 3)
+#define SEG_E (1u << 4)
+#define SEG_F (1u << 5)
+#define SEG_G (1u << 6)
+#define SEG_P (1u << 7)
+
+// Rate the scanner times the lit and dark parts of a digit at, whatever clk_sys is
+#define DISPLAY_RATE_HZ 1000000
+
+// Brightness levels, from 0 (dimmest) to DISPLAY_BRIGHTNESS_LEVELS - 1 (full)
+#define DISPLAY_BRIGHTNESS_LEVELS 8
+
+// Text wider than the display scrolls: it is rendered once into a strip of
+// packed digits, and the scanner steps a 4-digit window along it. The
+// scanner goes through DISPLAY_SCROLL_STEPS steps over and over, holding
+// each for DISPLAY_SCROLL_FRAMES frames of 4 ms, so the window moves every
+// 200 ms and waits at either end for the steps it does not take.
+#define DISPLAY_SCROLL_STEPS 32
+#define DISPLAY_SCROLL_FRAMES 50
+
+// Longest strip, leaving at least two steps of wait at each end
+#define DISPLAY_STRIP_MAX (DISPLAY_SCROLL_STEPS - 1)
+
+/*
+ *	Starts scanning the display, either with PIO or on core 1
+ *
+ *	Segments A-G and the decimal point are on `segment_pin` to `segment_pin + 7`
+ *	and digits 1-4 are on `digit_pin` to `digit_pin + 3`.
+ */
+void display_init(uint segment_pin, uint digit_pin);
+
+/*
+ *	Returns the packed segments for an ASCII character, or 0 if it has no glyph
+ */
+uint8_t display_glyph(char c);
+
+/*
+ *	Sets the packed segments of one digit in the back buffer
+ *
+ *	Changes to the back buffer are not visible until display_show is called.
+ */
+void set_segments(uint selector, uint8_t segments);
+
+/*
+ *	Sets 7-segment digit state to a hex digit value
+ */
+void set_digit(uint selector, uint value);
+
+/*
+ *	Sets 7-segment digit state to an ASCII character
+ */
+void set_char(uint selector, char c);
+
+/*
+ *	Renders ASCII `text` into at most `max` packed digits of `strip`, returning the number used
+ *
+ *	A '.' lights the decimal point of the digit before it rather than taking
+ *	one of its own.
+ */
+uint display_render_strip(const char *text, uint8_t *strip, uint max);
+
+/*
+ *	Returns the back buffer packed as the scanner reads it, digit 0 in the low byte
+ */
+uint32_t display_back_segments();
+
+/*
+ *	Publishes the back buffer; the scanner picks it up at the next frame
+ *
+ *	Stops a scroll in progress.
+ */
+void display_show();
+
+/*
+ *	Scrolls `text` across the display until the next display_show, or shows it still if it fits
+ *
+ *	Text past DISPLAY_STRIP_MAX digits is cut off. The scanner steps through
+ *	it on its own, so the CPU is not involved again until it changes.
+ */
+void display_scroll(const char *text);
+
+/*
+ *	Blanks all digits of the 7-segment display
+ */
+void display_off();
+
+/*
+ *	Sets how long each digit is lit for, from the next frame on
+ *
+ *	Levels above the brightest are clamped to it.
+ */
+void display_set_brightness(uint level);
+
+/*
+ *	Returns the current brightness level
+ */
+uint display_get_brightness();
+
+/*
+ *	Retunes the scanner after clk_sys has changed
+ */
+void display_clock_changed();
+
+/*
+ *	Returns the rate the scanner actually runs at from the current clk_sys, to check against DISPLAY_RATE_HZ
+ */
+uint32_t display_rate_hz();
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <string.h>
+#include "display.h"
+
+// Glyphs and the back buffer; nothing here touches the hardware, so the
+// host tests build it as is
+
+// 7-segment glyphs indexed by ASCII character
+static const uint8_t SEGMENT_FONT[128] = {
+	['0'] = SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F,
+	['1'] = SEG_B | SEG_C,
+	['2'] = SEG_A | SEG_B | SEG_D | SEG_E | SEG_G,
+	['3'] = SEG_A | SEG_B | SEG_C | SEG_D | SEG_G,
+	['4'] = SEG_B | SEG_C | SEG_F | SEG_G,
+	['5'] = SEG_A | SEG_C | SEG_D | SEG_F | SEG_G,
+	['6'] = SEG_A | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,
+	['7'] = SEG_A | SEG_B | SEG_C,
+	['8'] = SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,
+	['9'] = SEG_A | SEG_B | SEG_C | SEG_F | SEG_G,
+
+	['A'] = SEG_A | SEG_B | SEG_C | SEG_E | SEG_F | SEG_G,
+	['b'] = SEG_C | SEG_D | SEG_E | SEG_F | SEG_G,
+	['C'] = SEG_A | SEG_D | SEG_E | SEG_F,
+	['c'] = SEG_D | SEG_E | SEG_G,
+	['d'] = SEG_B | SEG_C | SEG_D | SEG_E | SEG_G,
+	['E'] = SEG_A | SEG_D | SEG_E | SEG_F | SEG_G,
+	['F'] = SEG_A | SEG_E | SEG_F | SEG_G,
+	['G'] = SEG_A | SEG_C | SEG_D | SEG_E | SEG_F,
+	['H'] = SEG_B | SEG_C | SEG_E | SEG_F | SEG_G,
+	['h'] = SEG_C | SEG_E | SEG_F | SEG_G,
+	['I'] = SEG_E | SEG_F,
+	['i'] = SEG_E,
+	['J'] = SEG_B | SEG_C | SEG_D | SEG_E,
+	['L'] = SEG_D | SEG_E | SEG_F,
+	['n'] = SEG_C | SEG_E | SEG_G,
+	['O'] = SEG_A | SEG_B | SEG_C | SEG_D | SEG_E | SEG_F,
+	['o'] = SEG_C | SEG_D | SEG_E | SEG_G,
+	['P'] = SEG_A | SEG_B | SEG_E | SEG_F | SEG_G,
+	['q'] = SEG_A | SEG_B | SEG_C | SEG_F | SEG_G,
+	['r'] = SEG_E | SEG_G,
+	['S'] = SEG_A | SEG_C | SEG_D | SEG_F | SEG_G,
+	['t'] = SEG_D | SEG_E | SEG_F | SEG_G,
+	['U'] = SEG_B | SEG_C | SEG_D | SEG_E | SEG_F,
+	['u'] = SEG_C | SEG_D | SEG_E,
+	['y'] = SEG_B | SEG_C | SEG_D | SEG_F | SEG_G,
+
+	[' '] = 0,
+	['-'] = SEG_G,
+	['_'] = SEG_D,
+	['='] = SEG_D | SEG_G,
+	['*'] = SEG_A | SEG_B | SEG_F | SEG_G, // degree sign
+	['.'] = SEG_P,
+};
+
+// Digits are edited here, one byte of segments per digit, until display_show
+static uint8_t display_back[4] __attribute__((aligned(4)));
+
+uint8_t display_glyph(char c) {
+	return ((uint8_t)c < 128) ? SEGMENT_FONT[(uint8_t)c] : 0;
+}
+
+void set_segments(uint selector, uint8_t segments) {
+	display_back[selector] = segments;
+}
+
+void set_digit(uint selector, uint value) {
+	set_segments(selector, display_glyph("0123456789AbCdEF"[value & 0xf]));
+}
+
+void set_char(uint selector, char c) {
+	set_segments(selector, display_glyph(c));
+}
+
+uint display_render_strip(const char *text, uint8_t *strip, uint max) {
+	uint length = 0;
+	for (; *text; ++text) {
+		if (*text == '.' && length && !(strip[length - 1] & SEG_P)) {
+			strip[length - 1] |= SEG_P;
+		} else if (length < max) {
+			strip[length++] = display_glyph(*text);
+		} else {
+			break;
+		}
+	}
+	return length;
+}
+
+uint32_t display_back_segments() {
+	uint32_t segments;
+	memcpy(&segments, display_back, sizeof(segments));
+	return segments;
+}
@@ -0,0 +1,241 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include "flashlog.h"
+#include "arena.h"
+#include "crc.h"
+#include "hardware/sync.h"
+#if LIB_PICO_MULTICORE
+#include "pico/multicore.h"
+#endif
+
+_Static_assert(FLASHLOG_SIZE % FLASH_SECTOR_SIZE == 0, "FLASHLOG_SIZE must be a multiple of the sector size");
+_Static_assert(FLASHLOG_SIZE >= 2 * FLASH_SECTOR_SIZE, "FLASHLOG_SIZE must hold at least two sectors");
+
+#define FLASHLOG_SECTORS (FLASHLOG_SIZE / FLASH_SECTOR_SIZE)
+
+// End of the firmware image, from the linker script
+extern char __flash_binary_end;
+
+// Page being filled for each sensor, and where its block has got to
+static flashlog_page *pages;
+static pack_state *packers;
+
+// Time of each sensor's last logged sample
+static uint32_t last_logged[DHT_SENSOR_COUNT];
+static bool logged_any[DHT_SENSOR_COUNT];
+
+static uint32_t end = 0;
+static uint32_t boot = 0;
+
+// Samples lost to a full page that had not been flushed yet
+static uint32_t dropped = 0;
+
+// Boot number kept across warm restarts
+static uint32_t *retained_boot;
+
+/*
+ *	Returns the page at `position` in the region, mapped through XIP
+ */
+const flashlog_page *flashlog_page_at(uint position) {
+	return (const flashlog_page *)(uintptr_t)(XIP_BASE + FLASHLOG_OFFSET + position * FLASH_PAGE_SIZE);
+}
+
+uint16_t flashlog_crc(const flashlog_page *page) {
+	return crc16_update(CRC16_INIT, &page->sequence, sizeof(flashlog_page) - offsetof(flashlog_page, sequence));
+}
+
+bool flashlog_valid(const flashlog_page *page) {
+	return page->magic == FLASHLOG_MAGIC && page->crc == flashlog_crc(page);
+}
+
+/*
+ *	Checks that the page at `position` is intact and holds `sequence`
+ */
+bool flashlog_holds(uint position, uint32_t sequence) {
+	const flashlog_page *page = flashlog_page_at(position);
+	return page->sequence == sequence && flashlog_valid(page);
+}
+
+bool flashlog_erased(uint position) {
+	const flashlog_page *page = flashlog_page_at(position);
+	return page->magic == 0xffff && page->sequence == 0xffffffff;
+}
+
+void flashlog_program(uint32_t offset, const void *page, bool erase) {
+	// core 1 would fault fetching code from flash while it is busy
+#if LIB_PICO_MULTICORE
+	bool lockout = multicore_lockout_victim_is_initialized(1);
+	if (lockout) {
+		multicore_lockout_start_blocking();
+	}
+#endif
+	uint32_t status = save_and_disable_interrupts();
+	if (erase) {
+		flash_range_erase(offset, FLASH_SECTOR_SIZE);
+	}
+	flash_range_program(offset, page, FLASH_PAGE_SIZE);
+	restore_interrupts(status);
+#if LIB_PICO_MULTICORE
+	if (lockout) {
+		multicore_lockout_end_blocking();
+	}
+#endif
+}
+
+/*
+ *	Programs the next page of the log, erasing its sector first if it is the sector's first page
+ */
+void flashlog_write(flashlog_page *page) {
+	uint position = end % FLASHLOG_PAGES;
+	page->magic = FLASHLOG_MAGIC;
+	page->sequence = end;
+	page->boot = boot;
+	page->crc = flashlog_crc(page);
+	flashlog_program(FLASHLOG_OFFSET + position * FLASH_PAGE_SIZE, page, position % FLASHLOG_SECTOR_PAGES == 0);
+	++end;
+}
+
+/*
+ *	Finds where the next page goes and the boot number after the newest page's
+ */
+void flashlog_find_head() {
+	// sectors from 0 up to the head hold consecutive sequence numbers; the
+	// ones after it are erased or a lap older, so binary search for the last
+	// sector that follows on from sector 0
+	uint head;
+	const flashlog_page *first = flashlog_page_at(0);
+	const uint last = (FLASHLOG_SECTORS - 1) * FLASHLOG_SECTOR_PAGES;
+	if (flashlog_valid(first) && first->sequence % FLASHLOG_PAGES == 0) {
+		uint lo = 0;
+		uint hi = FLASHLOG_SECTORS - 1;
+		while (lo < hi) {
+			uint mid = (lo + hi + 1) / 2;
+			if (flashlog_holds(mid * FLASHLOG_SECTOR_PAGES, first->sequence + mid * FLASHLOG_SECTOR_PAGES)) {
+				lo = mid;
+			} else {
+				hi = mid - 1;
+			}
+		}
+		head = lo;
+	} else if (flashlog_valid(flashlog_page_at(last)) && flashlog_page_at(last)->sequence % FLASHLOG_PAGES == last) {
+		// power went between erasing sector 0 and writing it on a wrap
+		head = FLASHLOG_SECTORS - 1;
+	} else {
+		// empty or unreadable log; start a new one
+		return;
+	}
+
+	// the head sector fills from its first page, so the first erased page
+	// is where the next one goes; a page torn by power loss is skipped
+	uint start = head * FLASHLOG_SECTOR_PAGES;
+	uint used = 1;
+	while (used < FLASHLOG_SECTOR_PAGES && !flashlog_erased(start + used)) {
+		++used;
+	}
+	end = flashlog_page_at(start)->sequence + used;
+
+	for (uint i = used; i-- > 0;) {
+		if (flashlog_holds(start + i, end - used + i)) {
+			boot = flashlog_page_at(start + i)->boot + 1;
+			break;
+		}
+	}
+}
+
+void flashlog_init() {
+	if ((uintptr_t)&__flash_binary_end - XIP_BASE > FLASHLOG_OFFSET) {
+		panic("flash log overlaps the firmware");
+	}
+	pages = arena_alloc(DHT_SENSOR_COUNT * sizeof(flashlog_page));
+	packers = arena_alloc(DHT_SENSOR_COUNT * sizeof(pack_state));
+	retained_boot = arena_alloc(sizeof(uint32_t));
+
+	flashlog_find_head();
+	if (arena_retained()) {
+		boot = *retained_boot;
+	} else {
+		*retained_boot = boot;
+	}
+}
+
+/*
+ *	Returns true if `page` has no room left for another sample
+ */
+bool flashlog_full(const flashlog_page *page) {
+	return page->count == UINT8_MAX || page->length + PACK_MAX_SAMPLE > FLASHLOG_BLOCK_BYTES;
+}
+
+/*
+ *	Writes the page of `sensor` and starts a new block in it
+ */
+void flashlog_write_page(uint sensor) {
+	flashlog_write(&pages[sensor]);
+	pages[sensor].count = 0;
+	pages[sensor].length = 0;
+	memset(&packers[sensor], 0, sizeof(pack_state));
+}
+
+void flashlog_push(uint sensor, const history_sample *sample) {
+	if (logged_any[sensor] && sample->time_ms - last_logged[sensor] < FLASHLOG_PERIOD_MS) {
+		return;
+	}
+
+	// a full page waits for flashlog_flush, as writing it here would stall
+	// the captures of the other sensors and the display; the sample is lost
+	flashlog_page *page = &pages[sensor];
+	if (flashlog_full(page)) {
+		++dropped;
+		return;
+	}
+	logged_any[sensor] = true;
+	last_logged[sensor] = sample->time_ms;
+
+	page->sensor = sensor;
+	page->length += pack_sample(&packers[sensor], sample, page->data + page->length);
+	++page->count;
+}
+
+void flashlog_flush() {
+	for (uint i = 0; i < DHT_SENSOR_COUNT; ++i) {
+		if (flashlog_full(&pages[i])) {
+			flashlog_write_page(i);
+		}
+	}
+}
+
+uint32_t flashlog_dropped() {
+	return dropped;
+}
+
+void flashlog_dump() {
+	printf("flash log: pages %lu to %lu, boot %lu, %lu samples dropped\n", (unsigned long)flashlog_first(),
+		(unsigned long)end, (unsigned long)boot, (unsigned long)dropped);
+}
+
+uint32_t flashlog_boot() {
+	return boot;
+}
+
+uint32_t flashlog_first() {
+	// the head sector has lost its previous lap, every other sector still
+	// holds one
+	uint32_t limit = (end + FLASHLOG_SECTOR_PAGES - 1) / FLASHLOG_SECTOR_PAGES * FLASHLOG_SECTOR_PAGES;
+	return (limit > FLASHLOG_PAGES) ? limit - FLASHLOG_PAGES : 0;
+}
+
+uint32_t flashlog_end() {
+	return end;
+}
+
+const flashlog_page *flashlog_get(uint32_t sequence) {
+	if (sequence < flashlog_first() || sequence >= end || !flashlog_holds(sequence % FLASHLOG_PAGES, sequence)) {
+		return NULL;
+	}
+	return flashlog_page_at(sequence % FLASHLOG_PAGES);
+}
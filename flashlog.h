@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _FLASHLOG_H
+#define _FLASHLOG_H
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "arena.h"
+#include "history.h"
+#include "pack.h"
+
+// Bytes of flash at the top of the chip given to the log; a multiple of the
+// 4 KB sector size, and it must not overlap the firmware
+#ifndef FLASHLOG_SIZE
+#define FLASHLOG_SIZE (1024 * 1024)
+#endif
+#define FLASHLOG_OFFSET (PICO_FLASH_SIZE_BYTES - FLASHLOG_SIZE)
+
+// Minimum time between logged samples of one sensor; 0 logs every sample
+#ifndef FLASHLOG_PERIOD_MS
+#define FLASHLOG_PERIOD_MS 60000
+#endif
+
+#define FLASHLOG_MAGIC 0x434c  // "LC"; raw samples were "LG"
+#define FLASHLOG_PAGES (FLASHLOG_SIZE / FLASH_PAGE_SIZE)
+#define FLASHLOG_SECTOR_PAGES (FLASH_SECTOR_SIZE / FLASH_PAGE_SIZE)
+
+// Bytes of a page its samples are packed into; a little short of the whole
+// page, so one goes out over USB as a single frame with its boot in front
+#define FLASHLOG_BLOCK_BYTES 236
+
+// One 256-byte flash page of samples from a single sensor, packed into one block
+//
+// Pages are written in order around the region, one sector erase every 16
+// pages, so every sector wears at the same rate. A page's sequence number
+// counts pages since the log was created and always lands it at position
+// sequence % FLASHLOG_PAGES.
+typedef struct {
+	uint16_t magic;
+	uint16_t crc;       // CRC-16/CCITT-FALSE of everything after this field
+	uint32_t sequence;
+	uint32_t boot;      // boot the sample times are relative to
+	uint8_t sensor;
+	uint8_t count;      // samples packed
+	uint16_t length;    // bytes of data they take, up to FLASHLOG_BLOCK_BYTES
+	uint8_t data[FLASH_PAGE_SIZE - 16];
+} flashlog_page;
+
+_Static_assert(sizeof(flashlog_page) == FLASH_PAGE_SIZE, "flashlog_page must fill one flash page");
+
+// Arena bytes taken by flashlog_init, for the page each sensor is filling,
+// where its block has got to and the boot number
+#define FLASHLOG_ARENA_BYTES (ARENA_BYTES(DHT_SENSOR_COUNT * sizeof(flashlog_page)) \
+	+ ARENA_BYTES(DHT_SENSOR_COUNT * sizeof(pack_state)) + ARENA_BYTES(sizeof(uint32_t)))
+
+/*
+ *	Finds the head of the log and the number of this boot, and takes the page buffers from the arena
+ *
+ *	Binary searches the first page of each sector, so startup reads a few
+ *	dozen page headers rather than the whole region.
+ */
+void flashlog_init();
+
+/*
+ *	Queues a sample of `sensor` for the log
+ *
+ *	Samples less than FLASHLOG_PERIOD_MS after the last logged one of the
+ *	same sensor are skipped. Queued samples are written a page at a time by
+ *	flashlog_flush, and lost if power goes before then. Never writes flash
+ *	itself: a sample that finds its sensor's page full because it has not
+ *	been flushed yet is dropped and counted.
+ */
+void flashlog_push(uint sensor, const history_sample *sample);
+
+/*
+ *	Writes every full page to flash
+ *
+ *	Interrupts on this core are disabled and core 1 is parked while flash is
+ *	busy, up to about 50 ms for a sector erase, so only call this while no
+ *	sensor read is in progress.
+ */
+void flashlog_flush();
+
+/*
+ *	Programs the flash page at `offset`, erasing the sector it starts first if `erase` is set
+ *
+ *	Interrupts on this core are disabled and core 1 is parked while flash is
+ *	busy, as for flashlog_flush.
+ */
+void flashlog_program(uint32_t offset, const void *page, bool erase);
+
+/*
+ *	Returns the number of samples dropped because their page was full and not yet flushed
+ */
+uint32_t flashlog_dropped();
+
+/*
+ *	Prints the range of pages held, the boot number and the dropped samples
+ */
+void flashlog_dump();
+
+/*
+ *	Returns the number of this boot, one more than the newest logged page's
+ *
+ *	A warm restart keeps the number of the boot it restarted, as sample
+ *	times go on from it.
+ */
+uint32_t flashlog_boot();
+
+/*
+ *	Returns the sequence number of the oldest page still in flash
+ */
+uint32_t flashlog_first();
+
+/*
+ *	Returns the sequence number the next page will be written with
+ */
+uint32_t flashlog_end();
+
+/*
+ *	Returns the page with `sequence`, read in place through XIP, or NULL if it has been overwritten or is corrupt
+ */
+const flashlog_page *flashlog_get(uint32_t sequence);
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "history.h"
+#include "arena.h"
+
+_Static_assert((HISTORY_SIZE & (HISTORY_SIZE - 1)) == 0, "HISTORY_SIZE must be a power of two");
+
+// One ring per sensor
+static history_sample (*samples)[HISTORY_SIZE];
+
+// Free-running count of pushed samples; masked to index the ring
+static uint32_t *heads;
+
+void history_init() {
+	samples = arena_alloc(DHT_SENSOR_COUNT * HISTORY_SIZE * sizeof(history_sample));
+	heads = arena_alloc(DHT_SENSOR_COUNT * sizeof(uint32_t));
+}
+
+void history_push(uint sensor, const history_sample *sample) {
+	samples[sensor][heads[sensor] & (HISTORY_SIZE - 1)] = *sample;
+	++heads[sensor];
+}
+
+uint history_count(uint sensor) {
+	return (heads[sensor] < HISTORY_SIZE) ? heads[sensor] : HISTORY_SIZE;
+}
+
+uint32_t history_total(uint sensor) {
+	return heads[sensor];
+}
+
+uint32_t history_oldest(uint sensor) {
+	return heads[sensor] - history_count(sensor);
+}
+
+uint history_span(uint sensor, uint32_t index, uint max, const history_sample **span) {
+	if (index < history_oldest(sensor) || index >= heads[sensor]) {
+		return 0;
+	}
+
+	// stop at the newest sample or the end of the ring, whichever comes first
+	uint offset = index & (HISTORY_SIZE - 1);
+	uint count = MIN(heads[sensor] - index, HISTORY_SIZE - offset);
+	*span = &samples[sensor][offset];
+	return MIN(count, max);
+}
+
+const history_sample *history_get(uint sensor, uint age) {
+	if (age >= history_count(sensor)) {
+		return NULL;
+	}
+	return &samples[sensor][(heads[sensor] - 1 - age) & (HISTORY_SIZE - 1)];
+}
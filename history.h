@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _HISTORY_H
+#define _HISTORY_H
+
+#include "pico/stdlib.h"
+#include "arena.h"
+#include "dht.h"
+
+// Samples kept in RAM for each sensor; must be a power of two
+#ifndef HISTORY_SIZE
+#define HISTORY_SIZE 256
+#endif
+
+// Compact timestamped reading
+typedef struct {
+	uint32_t time_ms;          // milliseconds since boot, going on across warm restarts
+	int16_t temp_tenths;       // tenths of a degree celsius
+	uint16_t humidity_tenths;  // tenths of a percent
+} history_sample;
+
+// Arena bytes taken by history_init
+#define HISTORY_ARENA_BYTES (ARENA_BYTES(DHT_SENSOR_COUNT * HISTORY_SIZE * sizeof(history_sample)) \
+	+ ARENA_BYTES(DHT_SENSOR_COUNT * sizeof(uint32_t)))
+
+/*
+ *	Takes a ring for each of DHT_SENSOR_COUNT sensors from the arena
+ */
+void history_init();
+
+/*
+ *	Appends a sample of `sensor`, overwriting its oldest one once its ring is full
+ */
+void history_push(uint sensor, const history_sample *sample);
+
+/*
+ *	Returns the number of samples currently held for `sensor`, at most HISTORY_SIZE
+ */
+uint history_count(uint sensor);
+
+/*
+ *	Returns the total number of samples ever pushed for `sensor`
+ */
+uint32_t history_total(uint sensor);
+
+/*
+ *	Returns the index of the oldest sample of `sensor` still held
+ *
+ *	Samples are indexed by push order, so the latest one is history_total - 1.
+ */
+uint32_t history_oldest(uint sensor);
+
+/*
+ *	Points `span` at the samples of `sensor` starting at `index`, without copying
+ *
+ *	Returns how many samples (at most `max`) are contiguous in memory from
+ *	there, or 0 if `index` is no longer held or has not been pushed yet.
+ */
+uint history_span(uint sensor, uint32_t index, uint max, const history_sample **span);
+
+/*
+ *	Returns the sample of `sensor` pushed `age` samples ago (0 is the latest), or NULL if it is no longer held
+ */
+const history_sample *history_get(uint sensor, uint age);
+
+#endif
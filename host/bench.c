@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crc.h"
+#include "display.h"
+#include "render.h"
+#include "trace.h"
+
+// Throughput of the decode and render paths on the host, as a regression
+// check before flashing; the numbers are for comparison between builds on
+// one machine, not a prediction of the RP2040's
+//
+// Usage: bench [minimum decodes per second]
+
+#define BENCH_SECONDS 0.2
+
+static volatile uint32_t sink;
+
+// The capture callbacks are not exercised here
+void dht_on_released(uint sensor) {
+}
+
+void dht_on_preamble(uint sensor) {
+}
+
+void dht_on_frame(uint sensor) {
+}
+
+double now_s() {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/*
+ *	Decodes the trace loaded into every sensor slot, returning frames per second
+ */
+double bench_decode(uint sensors) {
+	uint64_t frames = 0;
+	double start = now_s();
+	double elapsed;
+	do {
+		for (uint batch = 0; batch < 1000; ++batch) {
+			for (uint i = 0; i < sensors; ++i) {
+				dht_reading reading;
+				sink += dht_model_decode(i, &reading) + reading.temp_tenths;
+			}
+		}
+		frames += 1000 * sensors;
+		elapsed = now_s() - start;
+	} while (elapsed < BENCH_SECONDS);
+	return frames / elapsed;
+}
+
+/*
+ *	Renders readings across every display mode, returning renders per second
+ */
+double bench_render() {
+	uint64_t renders = 0;
+	double start = now_s();
+	double elapsed;
+	do {
+		for (int temp = -100; temp < 400; temp += 5) {
+			render_reading(renders % RENDER_MODES, renders & 1, temp, (temp + 200) * 2);
+			sink += display_back_segments();
+			++renders;
+		}
+		elapsed = now_s() - start;
+	} while (elapsed < BENCH_SECONDS);
+	return renders / elapsed;
+}
+
+/*
+ *	Checksums flash-log-sized pages, returning bytes per second
+ */
+double bench_crc() {
+	static uint8_t page[256];
+	for (uint i = 0; i < sizeof(page); ++i) {
+		page[i] = i * 37;
+	}
+	uint64_t bytes = 0;
+	double start = now_s();
+	double elapsed;
+	do {
+		for (uint batch = 0; batch < 1000; ++batch) {
+			sink += crc16_update(CRC16_INIT, page, sizeof(page));
+		}
+		bytes += 1000 * sizeof(page);
+		elapsed = now_s() - start;
+	} while (elapsed < BENCH_SECONDS);
+	return bytes / elapsed;
+}
+
+int main(int argc, char **argv) {
+	double min_decodes = (argc > 1) ? atof(argv[1]) : 0;
+
+	static trace_frame trace[DHT_MAX_SENSORS];
+	uint count = trace_load(TRACE_FILE, trace, count_of(trace));
+	for (uint i = 0; i < count; ++i) {
+		memcpy(dht_pulses[i], trace[i].pulses, sizeof(trace[i].pulses));
+	}
+
+	double decodes = bench_decode(count);
+	printf("decode  %12.0f frames/s  %6.1f ns/frame\n", decodes, 1e9 / decodes);
+	double renders = bench_render();
+	printf("render  %12.0f renders/s %6.1f ns/render\n", renders, 1e9 / renders);
+	double crc = bench_crc();
+	printf("crc16   %12.1f MB/s\n", crc / 1e6);
+
+	if (decodes < min_decodes) {
+		fprintf(stderr, "decode throughput %.0f frames/s is below the floor of %.0f\n", decodes, min_decodes);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,228 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define HAL_MAX_ALARMS 16
+
+typedef struct {
+	alarm_id_t id;  // 0 when the slot is free
+	absolute_time_t time;
+	alarm_callback_t callback;
+	void *user_data;
+} hal_alarm;
+
+static uint64_t now_us;
+static hal_alarm alarms[HAL_MAX_ALARMS];
+static alarm_id_t next_alarm_id;
+
+// Bank state, one bit per pin
+static uint32_t outputs;    // direction
+static uint32_t values;     // output values
+static uint32_t driven;     // levels driven from outside
+static uint32_t irq_edges[NUM_BANK0_GPIOS];
+static uint32_t irq_events[NUM_BANK0_GPIOS];
+static irq_handler_t bank_handler;
+static bool bank_enabled;
+
+void panic(const char *fmt, ...) {
+	va_list args;
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+	abort();
+}
+
+uint64_t time_us_64() {
+	return now_us;
+}
+
+uint32_t time_us_32() {
+	return (uint32_t)now_us;
+}
+
+absolute_time_t get_absolute_time() {
+	return now_us;
+}
+
+absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) {
+	return t + us;
+}
+
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) {
+	return t + ms * 1000ull;
+}
+
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+	return (int64_t)(to - from);
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t) {
+	return (uint32_t)(t / 1000);
+}
+
+alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+	for (uint i = 0; i < HAL_MAX_ALARMS; ++i) {
+		if (!alarms[i].id) {
+			alarms[i] = (hal_alarm){++next_alarm_id, time, callback, user_data};
+			return alarms[i].id;
+		}
+	}
+	panic("out of simulated alarms");
+	return -1;
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+	return add_alarm_at(now_us + us, callback, user_data, fire_if_past);
+}
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past) {
+	return add_alarm_at(now_us + ms * 1000ull, callback, user_data, fire_if_past);
+}
+
+bool cancel_alarm(alarm_id_t id) {
+	for (uint i = 0; i < HAL_MAX_ALARMS; ++i) {
+		if (alarms[i].id == id) {
+			alarms[i].id = 0;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ *	Returns the level a line reads at
+ */
+bool hal_level(uint pin) {
+	uint32_t bit = 1u << pin;
+	return (outputs & bit) ? (values & bit) != 0 : (driven & bit) != 0;
+}
+
+/*
+ *	Returns the levels of every line, one bit per pin
+ */
+uint32_t hal_levels() {
+	uint32_t levels = 0;
+	for (uint pin = 0; pin < NUM_BANK0_GPIOS; ++pin) {
+		levels |= (uint32_t)hal_level(pin) << pin;
+	}
+	return levels;
+}
+
+/*
+ *	Latches the edge events of every line whose level has changed and runs the bank's handler
+ */
+void hal_update(uint32_t before) {
+	uint32_t after = hal_levels();
+	bool raised = false;
+	for (uint pin = 0; pin < NUM_BANK0_GPIOS; ++pin) {
+		uint32_t bit = 1u << pin;
+		if ((before ^ after) & bit) {
+			uint32_t event = (after & bit) ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+			if (irq_edges[pin] & event) {
+				irq_events[pin] |= event;
+				raised = true;
+			}
+		}
+	}
+	if (raised && bank_enabled && bank_handler) {
+		bank_handler();
+	}
+}
+
+void gpio_init(uint pin) {
+	uint32_t before = hal_levels();
+	outputs &= ~(1u << pin);
+	values &= ~(1u << pin);
+	hal_update(before);
+}
+
+void gpio_pull_up(uint pin) {
+}
+
+void gpio_set_dir(uint pin, bool out) {
+	uint32_t before = hal_levels();
+	outputs = out ? outputs | (1u << pin) : outputs & ~(1u << pin);
+	hal_update(before);
+}
+
+void gpio_put(uint pin, bool value) {
+	uint32_t before = hal_levels();
+	values = value ? values | (1u << pin) : values & ~(1u << pin);
+	hal_update(before);
+}
+
+bool gpio_get(uint pin) {
+	return hal_level(pin);
+}
+
+void gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled) {
+	irq_edges[pin] = enabled ? irq_edges[pin] | events : irq_edges[pin] & ~events;
+}
+
+uint32_t gpio_get_irq_event_mask(uint pin) {
+	return irq_events[pin];
+}
+
+void gpio_acknowledge_irq(uint pin, uint32_t events) {
+	irq_events[pin] &= ~events;
+}
+
+void gpio_add_raw_irq_handler_masked(uint32_t mask, irq_handler_t handler) {
+	bank_handler = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+	if (num == IO_IRQ_BANK0) {
+		bank_enabled = enabled;
+	}
+}
+
+void hal_reset() {
+	now_us = 0;
+	memset(alarms, 0, sizeof(alarms));
+	outputs = 0;
+	values = 0;
+	driven = ~0u;
+	memset(irq_edges, 0, sizeof(irq_edges));
+	memset(irq_events, 0, sizeof(irq_events));
+	bank_handler = NULL;
+	bank_enabled = false;
+}
+
+void hal_advance_us(uint64_t us) {
+	uint64_t end = now_us + us;
+	while (1) {
+		// earliest alarm due by the end, oldest first on a tie
+		hal_alarm *due = NULL;
+		for (uint i = 0; i < HAL_MAX_ALARMS; ++i) {
+			if (alarms[i].id && alarms[i].time <= end && (!due || alarms[i].time < due->time || (alarms[i].time == due->time && alarms[i].id < due->id))) {
+				due = &alarms[i];
+			}
+		}
+		if (!due) {
+			break;
+		}
+		hal_alarm alarm = *due;
+		due->id = 0;
+		now_us = MAX(now_us, alarm.time);
+		int64_t again = alarm.callback(alarm.id, alarm.user_data);
+		if (again > 0) {
+			add_alarm_in_us(again, alarm.callback, alarm.user_data, true);
+		}
+	}
+	now_us = end;
+}
+
+void hal_drive(uint pin, bool level) {
+	uint32_t before = hal_levels();
+	driven = level ? driven | (1u << pin) : driven & ~(1u << pin);
+	hal_update(before);
+}
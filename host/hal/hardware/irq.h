@@ -0,0 +1,13 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _HARDWARE_IRQ_H
+#define _HARDWARE_IRQ_H
+
+// The simulated interrupt calls live with the rest of the shim
+#include "pico/stdlib.h"
+
+#endif
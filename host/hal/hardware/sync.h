@@ -0,0 +1,20 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _HARDWARE_SYNC_H
+#define _HARDWARE_SYNC_H
+
+#include "pico/stdlib.h"
+
+// Simulated interrupts only run from hal_* calls, so there is nothing to mask
+static inline uint32_t save_and_disable_interrupts() {
+	return 0;
+}
+
+static inline void restore_interrupts(uint32_t status) {
+}
+
+#endif
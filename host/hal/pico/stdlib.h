@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _PICO_STDLIB_H
+#define _PICO_STDLIB_H
+
+// Host stand-in for the parts of the pico-sdk the hardware-free modules and
+// the IRQ capture backend use: a simulated GPIO bank, timer and alarm pool,
+// driven by the hal_* calls at the bottom
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef unsigned int uint;
+
+#define MIN(a, b) ((b) < (a) ? (b) : (a))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+// RAM the runtime does not clear at boot, and functions copied to SRAM;
+// nothing to tell apart on the host
+#define __uninitialized_ram(group) group
+#define __not_in_flash_func(func) func
+
+void panic(const char *fmt, ...);
+
+// Time, from a simulated clock that only moves with hal_advance_us
+typedef uint64_t absolute_time_t;
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+uint64_t time_us_64();
+uint32_t time_us_32();
+absolute_time_t get_absolute_time();
+absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us);
+absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms);
+int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to);
+uint32_t to_ms_since_boot(absolute_time_t t);
+
+alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback, void *user_data, bool fire_if_past);
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past);
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past);
+bool cancel_alarm(alarm_id_t id);
+
+// GPIO; a line reads low while it outputs low, and otherwise whatever
+// hal_drive last put on it, high by default as with a pull-up
+#define GPIO_IN false
+#define GPIO_OUT true
+#define NUM_BANK0_GPIOS 30
+
+enum gpio_irq_level {
+	GPIO_IRQ_LEVEL_LOW = 0x1u,
+	GPIO_IRQ_LEVEL_HIGH = 0x2u,
+	GPIO_IRQ_EDGE_FALL = 0x4u,
+	GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+typedef void (*irq_handler_t)(void);
+
+#define IO_IRQ_BANK0 13
+
+void gpio_init(uint pin);
+void gpio_pull_up(uint pin);
+void gpio_set_dir(uint pin, bool out);
+void gpio_put(uint pin, bool value);
+bool gpio_get(uint pin);
+void gpio_set_irq_enabled(uint pin, uint32_t events, bool enabled);
+uint32_t gpio_get_irq_event_mask(uint pin);
+void gpio_acknowledge_irq(uint pin, uint32_t events);
+void gpio_add_raw_irq_handler_masked(uint32_t mask, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+
+/*
+ *	Puts the simulation back to time 0 with every line released and no alarms or handlers
+ */
+void hal_reset();
+
+/*
+ *	Moves the clock on by `us`, firing the alarms that fall due on the way in order
+ */
+void hal_advance_us(uint64_t us);
+
+/*
+ *	Drives a line from outside, as a sensor would, raising its edge interrupts
+ */
+void hal_drive(uint pin, bool level);
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _TEST_H
+#define _TEST_H
+
+#include <stdio.h>
+
+// Minimal checks for the host tests: a failed check is reported and counted,
+// and the test returns test_result() as its exit status
+
+extern int test_failures;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			++test_failures; \
+		} \
+	} while (0)
+
+#define CHECK_EQ(actual, expected) \
+	do { \
+		long long actual_ = (actual); \
+		long long expected_ = (expected); \
+		if (actual_ != expected_) { \
+			fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, actual_, expected_); \
+			++test_failures; \
+		} \
+	} while (0)
+
+static inline int test_result() {
+	if (test_failures) {
+		fprintf(stderr, "%d checks failed\n", test_failures);
+	}
+	return test_failures ? 1 : 0;
+}
+
+#endif
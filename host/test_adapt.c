@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "test.h"
+#include "adapt.h"
+
+int test_failures = 0;
+
+/*
+ *	Pushes one round of a single sensor's reading, returning the interval that follows
+ */
+uint32_t round_of(uint32_t time_ms, int16_t temp_tenths, uint16_t humidity_tenths) {
+	history_sample sample = {time_ms, temp_tenths, humidity_tenths};
+	adapt_push(0, &sample);
+	return adapt_update(time_ms);
+}
+
+int main() {
+	adapt_init(4000);
+	CHECK_EQ(adapt_period_ms(), 4000);
+
+	// the first round has nothing to compare with
+	uint32_t t = 0;
+	CHECK_EQ(round_of(t, 200, 500), 4000);
+
+	// calm rounds widen the interval only once there are enough in a row
+	for (uint i = 1; i < ADAPT_CALM_ROUNDS; ++i) {
+		CHECK_EQ(round_of(t += 4000, 200 + i % 2 * ADAPT_CALM_TEMP, 500), 4000);
+	}
+	CHECK_EQ(round_of(t += 4000, 200, 500), 8000);
+
+	// a moving round breaks the run of calm ones
+	for (uint i = 1; i < ADAPT_CALM_ROUNDS; ++i) {
+		CHECK_EQ(round_of(t += 8000, 200, 500), 8000);
+	}
+	int16_t temp = 200 + ADAPT_CALM_TEMP + 1;
+	CHECK_EQ(round_of(t += 8000, temp, 500), 4000);
+	for (uint i = 1; i < ADAPT_CALM_ROUNDS; ++i) {
+		CHECK_EQ(round_of(t += 4000, temp, 500), 4000);
+	}
+	CHECK_EQ(round_of(t += 4000, temp, 500), 8000);
+
+	// steady movement holds the interval, picking up halves it
+	CHECK_EQ(round_of(t += 8000, temp += ADAPT_CALM_TEMP + 1, 500), 4000);
+	CHECK_EQ(round_of(t += 4000, temp += ADAPT_CALM_TEMP + 1, 500), 4000);
+
+	// a fast change goes straight to the minimum
+	CHECK_EQ(round_of(t += 4000, temp, 500 + ADAPT_FAST_HUMIDITY), ADAPT_MIN_PERIOD_MS);
+
+	// and calm widens it back up to the maximum, no further
+	uint32_t period = ADAPT_MIN_PERIOD_MS;
+	for (uint i = 0; i < 100 * ADAPT_CALM_ROUNDS; ++i) {
+		period = round_of(t += period, temp, 500 + ADAPT_FAST_HUMIDITY);
+	}
+	CHECK_EQ(period, ADAPT_MAX_PERIOD_MS);
+
+	// rounds where every read failed change nothing
+	CHECK_EQ(adapt_update(t += period), ADAPT_MAX_PERIOD_MS);
+
+	// another sensor's reading is compared with its own last one
+	history_sample a = {t += period, temp, 500 + ADAPT_FAST_HUMIDITY};
+	history_sample b = {t, 0, 0};
+	adapt_push(0, &a);
+	adapt_push(1, &b);
+	CHECK_EQ(adapt_update(t), ADAPT_MAX_PERIOD_MS);
+	b.time_ms = a.time_ms = t += period;
+	adapt_push(0, &a);
+	adapt_push(1, &b);
+	CHECK_EQ(adapt_update(t), ADAPT_MAX_PERIOD_MS);
+
+	return test_result();
+}
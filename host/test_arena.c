@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdint.h>
+#include "test.h"
+#include "arena.h"
+
+int test_failures = 0;
+
+int main() {
+	// allocations are aligned, zeroed and never overlap
+	uint8_t *a = arena_alloc(3);
+	uint8_t *b = arena_alloc(16);
+	CHECK_EQ((uintptr_t)a % ARENA_ALIGN, 0);
+	CHECK_EQ((uintptr_t)b % ARENA_ALIGN, 0);
+	CHECK(b >= a + 3);
+	CHECK_EQ(b[15], 0);
+	CHECK_EQ(arena_used(), 8 + 16);
+
+	// a pool hands out each block once, then none until one comes back
+	arena_pool pool;
+	arena_pool_init(&pool, 100, 3);
+	CHECK_EQ(pool.block_size % ARENA_ALIGN, 0);
+	void *blocks[3];
+	for (uint i = 0; i < 3; ++i) {
+		blocks[i] = arena_pool_take(&pool);
+		CHECK(blocks[i] != NULL);
+		CHECK_EQ(arena_pool_index(&pool, blocks[i]), i);
+	}
+	CHECK(arena_pool_take(&pool) == NULL);
+
+	arena_pool_give(&pool, blocks[1]);
+	CHECK(arena_pool_take(&pool) == blocks[1]);
+	CHECK(arena_pool_take(&pool) == NULL);
+
+	// a full pool of the largest size
+	arena_pool big;
+	arena_pool_init(&big, 8, ARENA_POOL_MAX_BLOCKS);
+	uint taken = 0;
+	while (arena_pool_take(&big)) {
+		++taken;
+	}
+	CHECK_EQ(taken, ARENA_POOL_MAX_BLOCKS);
+
+	CHECK_EQ(arena_used(), 8 + 16 + 3 * 104 + ARENA_POOL_MAX_BLOCKS * 8);
+	CHECK(arena_used() <= arena_size());
+
+	return test_result();
+}
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <string.h>
+#include "test.h"
+#include "command.h"
+#include "crc.h"
+
+// Feeds command frames to the decoder a byte at a time, among single-letter
+// commands, corrupt frames and frames cut off by a pause
+
+int test_failures = 0;
+
+/*
+ *	Builds a frame of `type` into `out` and returns its length
+ */
+uint build(uint8_t *out, uint type, uint32_t sequence, uint32_t index, const void *payload, uint16_t length) {
+	telemetry_header header = {{COMMAND_MAGIC0, COMMAND_MAGIC1}, type, 0, sequence, index, length};
+	memcpy(out, &header, sizeof(header));
+	memcpy(out + sizeof(header), payload, length);
+	uint16_t crc = crc16_update(CRC16_INIT, out, sizeof(header) + length);
+	memcpy(out + sizeof(header) + length, &crc, sizeof(crc));
+	return sizeof(header) + length + sizeof(crc);
+}
+
+/*
+ *	Feeds `length` bytes at `time_ms`, returning the number of frames completed and the letters left over in `letters`
+ */
+uint feed(const uint8_t *bytes, uint length, uint32_t time_ms, command_frame *frame, char *letters) {
+	uint frames = 0;
+	uint n = 0;
+	for (uint i = 0; i < length; ++i) {
+		bool ready;
+		if (!command_feed(bytes[i], time_ms, frame, &ready)) {
+			letters[n++] = bytes[i];
+		}
+		frames += ready;
+	}
+	letters[n] = '\0';
+	return frames;
+}
+
+int main() {
+	uint8_t bytes[256];
+	char letters[256];
+	command_frame frame;
+
+	// a set command between letters
+	uint32_t value = 30000;
+	uint length = 0;
+	bytes[length++] = 'm';
+	length += build(bytes + length, COMMAND_SET, 7, 0, &value, sizeof(value));
+	bytes[length++] = 's';
+	CHECK_EQ(feed(bytes, length, 0, &frame, letters), 1);
+	CHECK(strcmp(letters, "ms") == 0);
+	CHECK_EQ(frame.header.type, COMMAND_SET);
+	CHECK_EQ(frame.header.sequence, 7);
+	CHECK_EQ(frame.header.length, sizeof(value));
+	CHECK_EQ(frame.payload[0] | frame.payload[1] << 8, 30000);
+
+	// a corrupt frame is dropped, and the next one still decodes
+	length = build(bytes, COMMAND_GET, 8, 0, NULL, 0);
+	bytes[5] ^= 1;
+	length += build(bytes + length, COMMAND_GET, 9, 0, NULL, 0);
+	CHECK_EQ(feed(bytes, length, 0, &frame, letters), 1);
+	CHECK_EQ(frame.header.sequence, 9);
+
+	// a payload longer than any command's is dropped, with none of its bytes
+	// taken for letters, and the next frame still decodes
+	uint8_t big[COMMAND_MAX_PAYLOAD + 1] = {'d', 'l', '+', '-', 'u', 'd', 'l', '+', '-'};
+	length = build(bytes, COMMAND_SET, 10, 0, big, sizeof(big));
+	bytes[length++] = 'm';
+	length += build(bytes + length, COMMAND_GET, 11, 0, NULL, 0);
+	CHECK_EQ(feed(bytes, length, 0, &frame, letters), 1);
+	CHECK(strcmp(letters, "m") == 0);
+	CHECK_EQ(frame.header.sequence, 11);
+
+	// a garbled length swallows bytes only until the next pause
+	length = build(bytes, COMMAND_GET, 12, 0, NULL, 0);
+	bytes[sizeof(telemetry_header) - 2] = 0xff;
+	CHECK_EQ(feed(bytes, length, 2000, &frame, letters), 0);
+	CHECK_EQ(feed((const uint8_t *)"dl", 2, 2000, &frame, letters), 0);
+	CHECK(strcmp(letters, "") == 0);
+	CHECK_EQ(feed((const uint8_t *)"dl", 2, 2000 + COMMAND_TIMEOUT_MS + 1, &frame, letters), 0);
+	CHECK(strcmp(letters, "dl") == 0);
+
+	// a frame cut off by a pause does not swallow the letters after it
+	length = build(bytes, COMMAND_DUMP, 11, 0, &value, sizeof(value));
+	CHECK_EQ(feed(bytes, 6, 1000, &frame, letters), 0);
+	CHECK_EQ(feed((const uint8_t *)"dw", 2, 1000 + COMMAND_TIMEOUT_MS + 1, &frame, letters), 0);
+	CHECK(strcmp(letters, "dw") == 0);
+
+	// a 'T' that is not followed by 'C' starts no frame
+	CHECK_EQ(feed((const uint8_t *)"TTCx", 4, 5000, &frame, letters), 0);
+	CHECK(strcmp(letters, "") == 0);
+	length = build(bytes, COMMAND_SAVE, 12, 0, NULL, 0);
+	CHECK_EQ(feed(bytes + 1, length - 1, 9000, &frame, letters), 0);
+
+	return test_result();
+}
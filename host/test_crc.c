@@ -0,0 +1,26 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "test.h"
+#include "crc.h"
+
+int test_failures = 0;
+
+int main() {
+	// check values of the catalogued CRCs
+	CHECK_EQ(crc16_update(CRC16_INIT, "123456789", 9), 0x29b1);
+	CHECK_EQ(crc16_update(CRC16_INIT, "", 0), CRC16_INIT);
+	CHECK_EQ(crc8_update(CRC8_INIT, "123456789", 9), 0xf7);
+
+	// the SHT3x datasheet's example word
+	const uint8_t word[2] = {0xbe, 0xef};
+	CHECK_EQ(crc8_update(CRC8_INIT, word, 2), 0x92);
+
+	// feeding the data in pieces gives the same CRC
+	CHECK_EQ(crc16_update(crc16_update(CRC16_INIT, "1234", 4), "56789", 5), 0x29b1);
+
+	return test_result();
+}
@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "trace.h"
+
+// Decodes every frame of the model's recorded traces, both straight from the
+// widths and replayed as edges on a simulated line through the IRQ capture
+// backend
+
+int test_failures = 0;
+
+static const uint PIN = 15;
+
+// Backend callbacks, which dht.c would otherwise handle
+static uint released;
+static uint preambles;
+static uint frames;
+static dht_status frame_status;
+static dht_reading frame_reading;
+
+void dht_on_released(uint sensor) {
+	++released;
+}
+
+void dht_on_preamble(uint sensor) {
+	++preambles;
+}
+
+void dht_on_frame(uint sensor) {
+	++frames;
+	frame_status = dht_model_decode(sensor, &frame_reading);
+}
+
+void check_decode(const trace_frame *frame) {
+	dht_reading reading = {0, 0};
+	memcpy(dht_pulses[0], frame->pulses, sizeof(frame->pulses));
+	CHECK_EQ(dht_model_decode(0, &reading), frame->status);
+	if (frame->status == DHT_OK) {
+		CHECK_EQ(reading.humidity_tenths, frame->reading.humidity_tenths);
+		CHECK_EQ(reading.temp_tenths, frame->reading.temp_tenths);
+	}
+
+	// every data bit lands in the histogram, and the closest to the
+	// threshold sets the margin
+	dht_diag diag = {.min_margin_us = UINT8_MAX};
+	dht_model_quality(0, &diag);
+	uint total = 0;
+	for (uint i = 0; i < DHT_DIAG_BINS; ++i) {
+		total += diag.widths[i];
+	}
+	uint margin = UINT8_MAX;
+	for (uint i = 1; i < DHT_PULSE_COUNT; ++i) {
+		margin = MIN(margin, (uint)abs((int)frame->pulses[i] - (int)dht_frame_threshold(frame->pulses)));
+	}
+	CHECK_EQ(total, DHT_PULSE_COUNT - 1);
+	CHECK_EQ(diag.last_margin_us, margin);
+	CHECK_EQ(diag.min_margin_us, margin);
+
+	// a full bin scales the histogram down rather than wrapping
+	for (uint i = 0; i < DHT_DIAG_BINS; ++i) {
+		diag.widths[i] = UINT16_MAX;
+	}
+	dht_model_quality(0, &diag);
+	for (uint i = 0; i < DHT_DIAG_BINS; ++i) {
+		CHECK(diag.widths[i] <= UINT16_MAX / 2 + DHT_PULSE_COUNT);
+	}
+}
+
+/*
+ *	Plays a frame onto the line the way a sensor answers a start pulse
+ */
+void replay(const trace_frame *frame) {
+	hal_reset();
+	released = preambles = frames = 0;
+	memset(dht_pulses, 0, sizeof(dht_pulses));
+
+	dht_backend_init(&PIN, 1);
+	dht_backend_start(0);
+	CHECK(!gpio_get(PIN));
+	hal_advance_us(DHT_START_PULSE_US);
+	CHECK_EQ(released, 1);
+	CHECK(gpio_get(PIN));
+
+	// the response low, then each high pulse with a 50 us low after it
+	hal_advance_us(30);
+	hal_drive(PIN, false);
+	hal_advance_us(80);
+	for (uint i = 0; i < DHT_PULSE_COUNT; ++i) {
+		hal_drive(PIN, true);
+		hal_advance_us(frame->pulses[i]);
+		hal_drive(PIN, false);
+		hal_advance_us(50);
+	}
+	hal_drive(PIN, true);
+
+	CHECK_EQ(preambles, 1);
+	CHECK_EQ(frames, 1);
+	CHECK(memcmp(dht_pulses[0], frame->pulses, sizeof(frame->pulses)) == 0);
+	CHECK_EQ(frame_status, frame->status);
+	if (frame->status == DHT_OK) {
+		CHECK_EQ(frame_reading.humidity_tenths, frame->reading.humidity_tenths);
+		CHECK_EQ(frame_reading.temp_tenths, frame->reading.temp_tenths);
+	}
+	CHECK_EQ(dht_backend_captured(0), DHT_PULSE_COUNT);
+	dht_backend_stop(0);
+}
+
+int main() {
+	static trace_frame trace[256];
+	uint count = trace_load(TRACE_FILE, trace, count_of(trace));
+	CHECK(count > 0);
+
+	for (uint i = 0; i < count; ++i) {
+		check_decode(&trace[i]);
+		replay(&trace[i]);
+	}
+
+	// any single flipped data bit fails the checksum
+	for (uint i = 0; i < count; ++i) {
+		if (trace[i].status != DHT_OK) {
+			continue;
+		}
+		for (uint bit = 1; bit < DHT_PULSE_COUNT; ++bit) {
+			trace_frame flipped = trace[i];
+			flipped.pulses[bit] = (flipped.pulses[bit] > 48) ? 26 : 70;
+			flipped.status = DHT_CHECKSUM;
+			check_decode(&flipped);
+		}
+	}
+
+	// the threshold follows the preamble, so frames counted in the wrong
+	// units, as by a capture clock that is off, still decode
+	for (uint i = 0; i < count; ++i) {
+		if (trace[i].status != DHT_OK) {
+			continue;
+		}
+		static const uint SCALES[][2] = {{3, 5}, {3, 2}, {3, 1}};
+		for (uint s = 0; s < count_of(SCALES); ++s) {
+			trace_frame scaled = trace[i];
+			for (uint p = 0; p < DHT_PULSE_COUNT; ++p) {
+				scaled.pulses[p] = scaled.pulses[p] * SCALES[s][0] / SCALES[s][1];
+			}
+			check_decode(&scaled);
+		}
+	}
+	CHECK_EQ(dht_frame_threshold((const uint32_t[DHT_PULSE_COUNT]){80}), 48);
+	CHECK_EQ(dht_frame_threshold((const uint32_t[DHT_PULSE_COUNT]){40}), 24);
+	CHECK_EQ(dht_frame_threshold((const uint32_t[DHT_PULSE_COUNT]){400}), 48);
+
+	// a sensor that never answers leaves the frame incomplete
+	hal_reset();
+	frames = 0;
+	dht_backend_init(&PIN, 1);
+	dht_backend_start(0);
+	hal_advance_us(DHT_START_PULSE_US + DHT_READ_TIME_MS * 1000);
+	CHECK_EQ(frames, 0);
+	CHECK_EQ(dht_backend_captured(0), 0);
+	dht_backend_stop(0);
+
+	// one that stops partway is timed out at the pulse it stopped on
+	hal_reset();
+	dht_backend_init(&PIN, 1);
+	dht_backend_start(0);
+	hal_advance_us(DHT_START_PULSE_US + 30);
+	hal_drive(PIN, false);
+	hal_advance_us(80);
+	for (uint i = 0; i < 10; ++i) {
+		hal_drive(PIN, true);
+		hal_advance_us(trace[0].pulses[i]);
+		hal_drive(PIN, false);
+		hal_advance_us(50);
+	}
+	CHECK_EQ(dht_backend_captured(0), 10);
+	dht_backend_stop(0);
+
+	return test_result();
+}
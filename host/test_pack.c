@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdlib.h>
+#include "test.h"
+#include "history.h"
+#include "pack.h"
+
+// Round trips samples through pack blocks: slow drift at a steady rate,
+// jumps of every size with times wrapping, and blocks cut off by size
+
+int test_failures = 0;
+
+#define SAMPLES 1000
+
+static history_sample samples[SAMPLES];
+static uint8_t block[SAMPLES * PACK_MAX_SAMPLE];
+
+/*
+ *	Packs samples[0..count) into one block, checks it unpacks to the same, and returns its length
+ */
+uint round_trip(uint count) {
+	pack_state state = {0};
+	uint length = 0;
+	for (uint i = 0; i < count; ++i) {
+		uint packed = pack_sample(&state, &samples[i], block + length);
+		CHECK(packed <= PACK_MAX_SAMPLE);
+		length += packed;
+	}
+
+	pack_state unpacking = {0};
+	uint used = 0;
+	for (uint i = 0; i < count; ++i) {
+		history_sample sample;
+		uint n = unpack_sample(&unpacking, block + used, length - used, &sample);
+		CHECK(n != 0);
+		CHECK_EQ(sample.time_ms, samples[i].time_ms);
+		CHECK_EQ(sample.temp_tenths, samples[i].temp_tenths);
+		CHECK_EQ(sample.humidity_tenths, samples[i].humidity_tenths);
+		used += n;
+	}
+	CHECK_EQ(used, length);
+	return length;
+}
+
+int main() {
+	srand(3);
+
+	// a steady room packs each sample into 2 bytes, after the first and the
+	// one that sets the rate
+	for (uint i = 0; i < SAMPLES; ++i) {
+		samples[i] = (history_sample){60000 * i + rand() % 20, 215 + rand() % 3 - 1, 480 + rand() % 5 - 2};
+	}
+	uint steady = round_trip(SAMPLES);
+	CHECK_EQ(steady, sizeof(history_sample) + 4 + 2 * (SAMPLES - 2));
+
+	// anything else still comes back the same, in at most PACK_MAX_SAMPLE
+	// bytes a sample
+	uint32_t time_ms = 0xfffff000;
+	for (uint i = 0; i < SAMPLES; ++i) {
+		time_ms += (i % 7 == 0) ? (uint32_t)rand() << 8 : (uint32_t)(rand() % 5000);
+		int16_t temp = (i % 11 == 0) ? (int)(INT16_MIN + (i & 1) * 0xffff) : rand() % 4000 - 2000;
+		uint16_t humidity = (i % 13 == 0) ? (i & 1) * 0xffff : (uint)(rand() % 1001);
+		samples[i] = (history_sample){time_ms, temp, humidity};
+	}
+	round_trip(SAMPLES);
+
+	// a block cut short fails to unpack rather than reading past it
+	uint length = round_trip(2);
+	pack_state state = {0};
+	history_sample sample;
+	CHECK_EQ(unpack_sample(&state, block, length, &sample), sizeof(history_sample));
+	CHECK_EQ(unpack_sample(&state, block + sizeof(history_sample), length - sizeof(history_sample) - 1, &sample), 0);
+
+	// history packs from an index for as long as there is room, across the
+	// ring wrapping
+	history_init();
+	for (uint i = 0; i < HISTORY_SIZE + 10; ++i) {
+		history_sample s = {2000 * i, 200 + i % 3, 500};
+		history_push(0, &s);
+	}
+	uint count;
+	uint32_t first = history_oldest(0);
+	CHECK_EQ(pack_history(0, first, block, sizeof(block), &count), sizeof(history_sample) + 3 + 2 * (HISTORY_SIZE - 2));
+	CHECK_EQ(count, HISTORY_SIZE);
+	CHECK_EQ(pack_history(0, first, block, sizeof(history_sample) + 3 + 2 * 9 + 1, &count), sizeof(history_sample) + 3 + 2 * 9);
+	CHECK_EQ(count, 11);
+	CHECK_EQ(pack_history(0, first, block, sizeof(history_sample) - 1, &count), 0);
+	CHECK_EQ(count, 0);
+	CHECK_EQ(pack_history(0, history_total(0), block, sizeof(block), &count), 0);
+	CHECK_EQ(count, 0);
+
+	printf("steady samples pack to %.2f bytes each\n", (double)steady / SAMPLES);
+	return test_result();
+}
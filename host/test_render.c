@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <math.h>
+#include <string.h>
+#include "test.h"
+#include "derived.h"
+#include "display.h"
+#include "render.h"
+
+// Checks the digits each display mode renders, and the derived quantities
+// against the floating point formulas the tables were generated from
+
+int test_failures = 0;
+
+/*
+ *	Packs the glyphs of a 4-character string, a '.' lighting the point of the character before it
+ */
+uint32_t glyphs(const char *text) {
+	uint32_t segments = 0;
+	uint digit = 0;
+	for (const char *c = text; *c; ++c) {
+		if (*c == '.') {
+			segments |= SEG_P << ((digit - 1) * 8);
+		} else {
+			segments |= (uint32_t)display_glyph(*c) << (digit++ * 8);
+		}
+	}
+	return segments;
+}
+
+#define CHECK_RENDER(mode, fahrenheit, temp, humidity, text) \
+	do { \
+		render_reading(mode, fahrenheit, temp, humidity); \
+		CHECK_EQ(display_back_segments(), glyphs(text)); \
+	} while (0)
+
+double dew_point(double temp, double humidity) {
+	double gamma = log(humidity / 100) + 17.62 * temp / (243.12 + temp);
+	return 243.12 * gamma / (17.62 - gamma);
+}
+
+// NWS heat index in fahrenheit
+double heat_index(double t, double rh) {
+	double hi = 0.5 * (t + 61 + (t - 68) * 1.2 + rh * 0.094);
+	if ((hi + t) / 2 < 80) {
+		return hi;
+	}
+	hi = -42.379 + 2.04901523 * t + 10.14333127 * rh - 0.22475541 * t * rh - 0.00683783 * t * t
+		- 0.05481717 * rh * rh + 0.00122874 * t * t * rh + 0.00085282 * t * rh * rh - 0.00000199 * t * t * rh * rh;
+	if (rh < 13 && t >= 80 && t <= 112) {
+		hi -= (13 - rh) / 4 * sqrt((17 - fabs(t - 95)) / 17);
+	} else if (rh > 85 && t >= 80 && t <= 87) {
+		hi += (rh - 85) / 10 * (87 - t) / 5;
+	}
+	return hi;
+}
+
+int main() {
+	CHECK_RENDER(RENDER_TEMP_HUMIDITY, true, 230, 452, "7345");
+	CHECK_RENDER(RENDER_TEMP_HUMIDITY, false, 230, 1000, "2399");
+	CHECK_RENDER(RENDER_TEMP_HUMIDITY, false, -53, 52, "-5 5");
+	CHECK_RENDER(RENDER_TEMP_HUMIDITY, false, -120, 400, "Lo40");
+
+	CHECK_RENDER(RENDER_TEMP, false, 234, 0, "23.4C");
+	CHECK_RENDER(RENDER_TEMP, false, 56, 0, " 5.6C");
+	CHECK_RENDER(RENDER_TEMP, false, -53, 0, "-5.3C");
+	CHECK_RENDER(RENDER_TEMP, false, -150, 0, "-15C");
+	CHECK_RENDER(RENDER_TEMP, true, 507, 0, "123F");
+	CHECK_RENDER(RENDER_TEMP, true, 10000, 0, " HIF");
+	CHECK_RENDER(RENDER_TEMP, false, -990, 0, "-99C");
+	CHECK_RENDER(RENDER_TEMP, false, -1100, 0, " LoC");
+
+	CHECK_RENDER(RENDER_HUMIDITY, false, 0, 452, "45.2h");
+	CHECK_RENDER(RENDER_HUMIDITY, false, 0, 1000, "100h");
+
+	// 25 C at 60% condenses at 16.69 C, and 95 F at 50% feels like 105.2 F
+	CHECK_RENDER(RENDER_DEW_POINT, false, 250, 600, "16.6C");
+	CHECK_RENDER(RENDER_HEAT_INDEX, true, 350, 500, "105F");
+
+	render_label(RENDER_DEW_POINT);
+	CHECK_EQ(display_back_segments(), glyphs("dEuP"));
+
+	double dew_error = 0;
+	double heat_error = 0;
+	for (int temp = -300; temp <= 600; temp += 7) {
+		for (int humidity = 50; humidity <= 1000; humidity += 13) {
+			double t = temp / 10.0;
+			double rh = humidity / 10.0;
+			dew_error = fmax(dew_error, fabs(derived_dew_point(temp, humidity) / 10.0 - dew_point(t, rh)));
+
+			double fahrenheit = t * 9 / 5 + 32;
+			if (fahrenheit <= 130) {
+				double expected = (fahrenheit < 40) ? t : (heat_index(fahrenheit, rh) - 32) * 5 / 9;
+				heat_error = fmax(heat_error, fabs(derived_heat_index(temp, humidity) / 10.0 - expected));
+			}
+		}
+	}
+	CHECK(dew_error <= 0.2);
+	CHECK(heat_error <= 1.5);
+	printf("max dew point error %.2f C, heat index error %.2f C\n", dew_error, heat_error);
+
+	// readings too wide for four digits come out whole for scrolling
+	char text[RENDER_TEXT_MAX];
+	CHECK(!render_reading_text(RENDER_TEMP, false, -99, 500, text, sizeof(text)));
+	CHECK(render_reading_text(RENDER_TEMP, false, -125, 500, text, sizeof(text)) && strcmp(text, "-12.5C") == 0);
+	CHECK(render_reading_text(RENDER_TEMP, true, 400, 500, text, sizeof(text)) && strcmp(text, "104.0F") == 0);
+	CHECK(!render_reading_text(RENDER_TEMP_HUMIDITY, false, -94, 500, text, sizeof(text)));
+	CHECK(render_reading_text(RENDER_TEMP_HUMIDITY, false, -150, 456, text, sizeof(text)) && strcmp(text, "-15C 46h") == 0);
+	CHECK(!render_reading_text(RENDER_HUMIDITY, false, 200, 999, text, sizeof(text)));
+
+	// and render into a strip a digit a character, points folded in
+	uint8_t strip[DISPLAY_STRIP_MAX];
+	CHECK_EQ(display_render_strip("-12.5C", strip, sizeof(strip)), 5);
+	CHECK_EQ(strip[2], display_glyph('2') | SEG_P);
+	CHECK_EQ(strip[3], display_glyph('5'));
+	CHECK_EQ(display_render_strip("..", strip, sizeof(strip)), 2);
+	CHECK_EQ(strip[0], SEG_P);
+	CHECK_EQ(display_render_strip("0123456789", strip, 4), 4);
+
+	return test_result();
+}
@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdlib.h>
+#include "test.h"
+#include "history.h"
+#include "stats.h"
+
+// Checks the rolling statistics against a brute force pass over every
+// sample still in each window, across gaps longer than the windows
+
+int test_failures = 0;
+
+#define SAMPLES 100000
+
+static history_sample samples[SAMPLES];
+
+int main() {
+	srand(2);
+	history_init();
+	stats_init();
+	uint32_t time_ms = 0;
+	for (uint k = 0; k < SAMPLES; ++k) {
+		time_ms += 2000 + ((k % 5000 == 0) ? 5000000 : 0);
+		samples[k] = (history_sample){time_ms, rand() % 2000 - 500, rand() % 1000};
+		stats_push(0, &samples[k]);
+		history_push(0, &samples[k]);
+
+		if (k % 997) {
+			continue;
+		}
+		for (uint w = 0; w < STATS_WINDOW_COUNT; ++w) {
+			// the window covers the newest bucket and the 15 before it
+			uint32_t bucket_ms = stats_window_s(w) * 1000 / STATS_BUCKETS;
+			uint32_t bucket = time_ms / bucket_ms;
+			int min = 99999;
+			int max = -99999;
+			long long sum = 0;
+			long long count = 0;
+			for (int j = k; j >= 0 && samples[j].time_ms / bucket_ms + STATS_BUCKETS > bucket; --j) {
+				min = MIN(min, samples[j].temp_tenths);
+				max = MAX(max, samples[j].temp_tenths);
+				sum += samples[j].temp_tenths;
+				++count;
+			}
+
+			stats_summary summary;
+			CHECK(stats_get(0, w, STATS_TEMP, &summary));
+			CHECK_EQ(summary.min, min);
+			CHECK_EQ(summary.max, max);
+			CHECK(llabs(summary.mean * count - sum) <= count);
+		}
+	}
+
+	CHECK_EQ(history_total(0), SAMPLES);
+	CHECK_EQ(history_count(0), HISTORY_SIZE);
+	CHECK_EQ(history_get(0, 0)->time_ms, samples[SAMPLES - 1].time_ms);
+	CHECK(history_get(0, HISTORY_SIZE) == NULL);
+
+	return test_result();
+}
@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdlib.h>
+#include <string.h>
+#include "trace.h"
+
+uint trace_load(const char *path, trace_frame *frames, uint max) {
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		perror(path);
+		exit(1);
+	}
+
+	char line[512];
+	uint count = 0;
+	uint number = 0;
+	while (count < max && fgets(line, sizeof(line), file)) {
+		++number;
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+
+		trace_frame *frame = &frames[count];
+		char status[16];
+		unsigned humidity;
+		int temp;
+		int used;
+		if (sscanf(line, "%15s %u %d%n", status, &humidity, &temp, &used) != 3) {
+			panic("%s:%u: bad trace line", path, number);
+		}
+		frame->status = strcmp(status, "ok") ? DHT_CHECKSUM : DHT_OK;
+		frame->reading = (dht_reading){humidity, temp};
+
+		const char *rest = line + used;
+		for (uint i = 0; i < DHT_PULSE_COUNT; ++i) {
+			char *end;
+			frame->pulses[i] = strtoul(rest, &end, 10);
+			if (end == rest) {
+				panic("%s:%u: expected %u pulse widths", path, number, DHT_PULSE_COUNT);
+			}
+			rest = end;
+		}
+		++count;
+	}
+	fclose(file);
+	return count;
+}
@@ -0,0 +1,27 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include "dht_backend.h"
+
+// One recorded frame and what it should decode to
+typedef struct {
+	dht_status status;
+	dht_reading reading;
+	uint32_t pulses[DHT_PULSE_COUNT];
+} trace_frame;
+
+/*
+ *	Loads up to `max` frames from a trace file, exiting if it cannot be read
+ *
+ *	Each line is `ok` or `checksum`, the humidity and temperature in tenths
+ *	and DHT_PULSE_COUNT pulse widths; `#` starts a comment line.
+ */
+uint trace_load(const char *path, trace_frame *frames, uint max);
+
+#endif
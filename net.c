@@ -0,0 +1,462 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdio.h>
+#include <string.h>
+#include "net.h"
+#include "arena.h"
+#include "flashlog.h"
+#include "history.h"
+#include "power.h"
+#include "pico/cyw43_arch.h"
+#include "pico/unique_id.h"
+#include "lwip/ip_addr.h"
+#if NET_MQTT
+#include "lwip/apps/mqtt.h"
+#include "lwip/apps/mqtt_priv.h"
+#else
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#endif
+
+#if !defined(WIFI_SSID) || !defined(WIFI_PASSWORD)
+#error "WIFI_SSID and WIFI_PASSWORD must be defined for the network build"
+#endif
+
+typedef enum {
+	NET_OFF,
+	NET_JOINING,
+	NET_CONNECTING,  // to the MQTT broker
+	NET_SENDING,
+	NET_DRAINING,    // waiting for the last packets to leave
+} net_state;
+
+static net_state state = NET_OFF;
+static bool radio_on = false;
+static bool burst_waiting = false;
+static bool available = false;
+static uint32_t burst_start_ms;
+static uint32_t next_burst_ms = NET_PERIOD_MS;
+static ip_addr_t host;
+static pico_unique_board_id_t board;
+
+// History index of the next sample to send, and the history total each
+// sensor's last stats frame covered
+static uint32_t cursors[DHT_SENSOR_COUNT];
+static uint32_t stats_sent[DHT_SENSOR_COUNT];
+static uint32_t sequence = 0;
+
+// Where the packet being sent leaves off, taken on once it has gone
+static uint32_t next_cursors[DHT_SENSOR_COUNT];
+static uint32_t next_stats_sent[DHT_SENSOR_COUNT];
+static uint next_frames;
+static uint next_samples;
+static uint32_t next_dropped;
+
+// Counts for net_dump
+static uint32_t bursts = 0;
+static uint32_t failures = 0;
+static uint32_t packets = 0;
+static uint32_t samples_sent = 0;
+static uint32_t dropped = 0;
+static uint32_t on_total_ms = 0;
+static uint32_t last_on_ms = 0;
+
+#if NET_MQTT
+// Connection to the broker; messages are copied into its output ring as
+// they are published, so a packet is built once in `packet` and can wait
+// there until the ring has room
+static mqtt_client_t client;
+static char client_id[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+static char topic[sizeof("thermometer/") + 2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES];
+static uint8_t *packet;
+static uint packet_length = 0;
+
+// Set from lwIP callbacks, which run in the radio's background IRQ
+static volatile bool connected = false;
+static volatile bool refused = false;
+static volatile uint outstanding = 0;
+#else
+// Packets are built in place in pool buffers behind NET_HEADROOM, which
+// lwIP writes its headers into, so nothing is copied or allocated per
+// packet until the radio driver takes the frame. A buffer goes back to the
+// pool once lwIP lets go of its pbuf, which can take a while if the packet
+// is queued waiting for ARP.
+_Static_assert(LWIP_MEM_ALIGN_SIZE(PBUF_TRANSPORT) <= NET_HEADROOM, "NET_HEADROOM must fit lwIP's headers");
+
+static arena_pool buffers;
+static struct pbuf_custom pbufs[NET_BUFFERS];
+static struct udp_pcb *pcb = NULL;
+#endif
+
+/*
+ *	Fills `out` with a packet of everything unsent that fits, noting where it leaves off
+ *
+ *	Returns the length of the packet, or 0 if there is nothing to send.
+ */
+uint net_fill(uint8_t *out) {
+	uint length = sizeof(net_header);
+	next_frames = 0;
+	next_samples = 0;
+	next_dropped = 0;
+
+	for (uint sensor = 0; sensor < dht_sensor_count(); ++sensor) {
+		// skip ahead if the ring has overwritten samples we never sent
+		next_cursors[sensor] = cursors[sensor];
+		if (next_cursors[sensor] < history_oldest(sensor)) {
+			next_dropped += history_oldest(sensor) - next_cursors[sensor];
+			next_cursors[sensor] = history_oldest(sensor);
+		}
+
+		uint count;
+		uint framed = telemetry_encode_packed(out + length, NET_PACKET_SIZE - length, sequence + next_frames,
+			sensor, next_cursors[sensor], &count);
+		if (framed) {
+			length += framed;
+			++next_frames;
+			next_cursors[sensor] += count;
+			next_samples += count;
+		}
+	}
+
+	// stats go out once a sensor's samples have all been sent, so they cover them
+	for (uint sensor = 0; sensor < dht_sensor_count(); ++sensor) {
+		telemetry_stats stats[STATS_WINDOW_COUNT];
+		next_stats_sent[sensor] = stats_sent[sensor];
+		if (stats_sent[sensor] == history_total(sensor) || next_cursors[sensor] != history_total(sensor)
+				|| length + TELEMETRY_OVERHEAD + sizeof(stats) > NET_PACKET_SIZE) {
+			continue;
+		}
+		telemetry_get_stats(sensor, stats);
+		next_stats_sent[sensor] = history_total(sensor);
+		length += telemetry_encode(out + length, sequence + next_frames++, TELEMETRY_STATS, sensor,
+			next_stats_sent[sensor], stats, sizeof(stats));
+	}
+
+	if (next_frames == 0) {
+		return 0;
+	}
+	net_header header = {
+		.magic = {NET_MAGIC0, NET_MAGIC1},
+		.boot = flashlog_boot(),
+		.frames = next_frames,
+	};
+	memcpy(header.board, board.id, sizeof(header.board));
+	memcpy(out, &header, sizeof(header));
+	return length;
+}
+
+/*
+ *	Takes on where the last filled packet left off, now that it has been sent
+ */
+void net_commit() {
+	memcpy(cursors, next_cursors, sizeof(cursors));
+	memcpy(stats_sent, next_stats_sent, sizeof(stats_sent));
+	sequence += next_frames;
+	samples_sent += next_samples;
+	dropped += next_dropped;
+	++packets;
+}
+
+/*
+ *	Powers the radio up and starts joining the network
+ */
+bool net_radio_up() {
+	if (cyw43_arch_init()) {
+		return false;
+	}
+	radio_on = true;
+	cyw43_arch_enable_sta_mode();
+	return cyw43_arch_wifi_connect_async(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK) == 0;
+}
+
+/*
+ *	Powers the radio down, which also drops the network and frees its PIO state machine and DMA channels
+ */
+void net_radio_down() {
+	if (radio_on) {
+		cyw43_arch_deinit();
+		radio_on = false;
+	}
+}
+
+/*
+ *	Ends the current burst and powers the radio down until the next one
+ */
+void net_end_burst(bool ok) {
+#if NET_MQTT
+	if (radio_on) {
+		// also stops a connection still being made
+		cyw43_arch_lwip_begin();
+		mqtt_disconnect(&client);
+		cyw43_arch_lwip_end();
+	}
+	packet_length = 0;
+#endif
+	net_radio_down();
+	if (!ok) {
+		++failures;
+	}
+	last_on_ms = to_ms_since_boot(get_absolute_time()) - burst_start_ms;
+	on_total_ms += last_on_ms;
+	state = NET_OFF;
+}
+
+#if NET_MQTT
+void net_connection_callback(mqtt_client_t *c, void *arg, mqtt_connection_status_t status) {
+	if (status == MQTT_CONNECT_ACCEPTED) {
+		connected = true;
+	} else {
+		connected = false;
+		refused = true;
+	}
+}
+
+void net_publish_callback(void *arg, err_t err) {
+	--outstanding;
+}
+
+/*
+ *	Starts connecting to the broker
+ */
+bool net_connect() {
+	const struct mqtt_connect_client_info_t info = {
+		.client_id = client_id,
+		.keep_alive = NET_BURST_TIMEOUT_MS / 1000,
+	};
+	connected = false;
+	refused = false;
+	outstanding = 0;
+	cyw43_arch_lwip_begin();
+	err_t err = mqtt_client_connect(&client, &host, NET_PORT, net_connection_callback, NULL, &info);
+	cyw43_arch_lwip_end();
+	return err == ERR_OK;
+}
+
+/*
+ *	Publishes packets until everything is sent or the output ring is full
+ *
+ *	Returns false if the connection has failed.
+ */
+bool net_send() {
+	while (1) {
+		if (!connected) {
+			return false;
+		}
+		if (packet_length == 0) {
+			packet_length = net_fill(packet);
+			if (packet_length == 0) {
+				state = NET_DRAINING;
+				return true;
+			}
+		}
+
+		cyw43_arch_lwip_begin();
+		++outstanding;
+		err_t err = mqtt_publish(&client, topic, packet, packet_length, 0, 0, net_publish_callback, NULL);
+		if (err != ERR_OK) {
+			--outstanding;
+		}
+		cyw43_arch_lwip_end();
+
+		if (err == ERR_MEM) {
+			// the ring or the request list is full; try again next tick
+			return true;
+		}
+		if (err != ERR_OK) {
+			return false;
+		}
+		net_commit();
+		packet_length = 0;
+	}
+}
+#else
+void net_pbuf_free(struct pbuf *p) {
+	// the pbuf is the first member of its pbuf_custom
+	struct pbuf_custom *custom = (struct pbuf_custom *)p;
+	arena_pool_give(&buffers, buffers.blocks + (custom - pbufs) * buffers.block_size);
+}
+
+/*
+ *	Sends packets until everything is sent or every buffer is in use
+ *
+ *	Returns false if lwIP fails to send one.
+ */
+bool net_send() {
+	uint8_t *buffer;
+	while ((buffer = arena_pool_take(&buffers))) {
+		uint length = net_fill(buffer + NET_HEADROOM);
+		if (length == 0) {
+			arena_pool_give(&buffers, buffer);
+			state = NET_DRAINING;
+			return true;
+		}
+
+		// lwIP puts the payload straight after its own headroom, which has
+		// to end where the packet starts
+		struct pbuf_custom *custom = &pbufs[arena_pool_index(&buffers, buffer)];
+		custom->custom_free_function = net_pbuf_free;
+		uint offset = NET_HEADROOM - LWIP_MEM_ALIGN_SIZE(PBUF_TRANSPORT);
+		cyw43_arch_lwip_begin();
+		struct pbuf *p = pbuf_alloced_custom(PBUF_TRANSPORT, length, PBUF_RAM, custom, buffer + offset, buffers.block_size - offset);
+		err_t err = udp_sendto(pcb, p, &host, NET_PORT);
+		pbuf_free(p);
+		cyw43_arch_lwip_end();
+
+		if (err == ERR_MEM) {
+			// out of lwIP buffers for the headers; try again next tick
+			return true;
+		}
+		if (err != ERR_OK) {
+			return false;
+		}
+		net_commit();
+	}
+	return true;
+}
+#endif
+
+/*
+ *	Returns true once every packet of the burst has left
+ */
+bool net_drained() {
+#if NET_MQTT
+	return outstanding == 0;
+#else
+	return buffers.free == (1u << NET_BUFFERS) - 1;
+#endif
+}
+
+void net_init() {
+#if NET_MQTT
+	packet = arena_alloc(NET_PACKET_SIZE);
+#else
+	arena_pool_init(&buffers, NET_HEADROOM + NET_PACKET_SIZE, NET_BUFFERS);
+#endif
+	pico_get_unique_board_id(&board);
+	ip4addr_aton(NET_HOST, ip_2_ip4(&host));
+#if NET_MQTT
+	pico_get_unique_board_id_string(client_id, sizeof(client_id));
+	snprintf(topic, sizeof(topic), "thermometer/%s", client_id);
+#endif
+
+	// the radio claims its resources on every init and frees them on every
+	// deinit, so claim them once now and leave them free for the next burst
+	available = cyw43_arch_init() == 0;
+	radio_on = available;
+}
+
+uint32_t net_poll() {
+	uint32_t now = to_ms_since_boot(get_absolute_time());
+	if (state != NET_OFF && now - burst_start_ms >= NET_BURST_TIMEOUT_MS) {
+		net_end_burst(false);
+	}
+
+	switch (state) {
+	case NET_OFF:
+		// left up by net_init
+		net_radio_down();
+		if (!available) {
+			return NET_PERIOD_MS;
+		}
+		if ((int32_t)(now - next_burst_ms) < 0) {
+			return next_burst_ms - now;
+		}
+
+		// a burst runs at full speed to keep the radio on for less time; the
+		// clock only changes between sensor reads, so wait for update_power
+		// to raise it rather than change it under the radio later
+		if (power_is_low()) {
+			burst_waiting = true;
+			return NET_TICK_MS;
+		}
+		burst_waiting = false;
+		next_burst_ms = now + NET_PERIOD_MS;
+		burst_start_ms = now;
+		++bursts;
+		state = NET_JOINING;
+		if (!net_radio_up()) {
+			net_end_burst(false);
+			return next_burst_ms - now;
+		}
+		break;
+
+	case NET_JOINING: {
+		int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+		if (status < 0) {
+			// bad password, no such network or no reply from it
+			net_end_burst(false);
+			return next_burst_ms - now;
+		}
+		if (status != CYW43_LINK_UP) {
+			break;
+		}
+#if NET_MQTT
+		state = NET_CONNECTING;
+		if (!net_connect()) {
+			net_end_burst(false);
+			return next_burst_ms - now;
+		}
+#else
+		// lwIP outlives the radio, so the pcb is made once and kept
+		if (!pcb) {
+			cyw43_arch_lwip_begin();
+			pcb = udp_new();
+			cyw43_arch_lwip_end();
+		}
+		if (!pcb) {
+			net_end_burst(false);
+			return next_burst_ms - now;
+		}
+		state = NET_SENDING;
+#endif
+		break;
+	}
+
+	case NET_CONNECTING:
+#if NET_MQTT
+		if (refused) {
+			net_end_burst(false);
+			return next_burst_ms - now;
+		}
+		if (connected) {
+			state = NET_SENDING;
+		}
+#endif
+		break;
+
+	case NET_SENDING:
+		if (!net_send()) {
+			net_end_burst(false);
+			return next_burst_ms - now;
+		}
+		break;
+
+	case NET_DRAINING:
+		if (net_drained()) {
+			net_end_burst(true);
+			return next_burst_ms - now;
+		}
+		break;
+	}
+
+	// sending may have drained straight away
+	if (state == NET_DRAINING && net_drained()) {
+		net_end_burst(true);
+		return next_burst_ms - now;
+	}
+	return NET_TICK_MS;
+}
+
+bool net_busy() {
+	return radio_on || burst_waiting;
+}
+
+void net_dump() {
+	printf("net: %lu bursts, %lu failed, %lu packets, %lu samples, %lu dropped, radio on %lu ms, last %lu ms\n",
+		(unsigned long)bursts, (unsigned long)failures, (unsigned long)packets, (unsigned long)samples_sent,
+		(unsigned long)dropped, (unsigned long)on_total_ms, (unsigned long)last_on_ms);
+}
@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _NET_H
+#define _NET_H
+
+#include "pico/stdlib.h"
+#include "telemetry.h"
+
+// Samples go out over Wi-Fi in bursts: the radio is powered up, joins the
+// network, sends everything new in as few packets as it can and is powered
+// down again. Each packet, a UDP datagram or an MQTT message published to
+// thermometer/<board id>, is a net_header followed by telemetry frames as
+// sent over USB, numbered by a sequence of their own.
+
+// Time between bursts
+#ifndef NET_PERIOD_MS
+#define NET_PERIOD_MS 300000
+#endif
+
+// Receiver's IPv4 address, and its UDP port or MQTT broker port
+#ifndef NET_HOST
+#define NET_HOST "192.168.1.2"
+#endif
+#ifndef NET_PORT
+#if NET_MQTT
+#define NET_PORT 1883
+#else
+#define NET_PORT 4950
+#endif
+#endif
+
+// A burst that has not finished by now gives up and powers the radio down;
+// whatever it did not send goes in the next one
+#define NET_BURST_TIMEOUT_MS 30000
+
+// Time between polls of the radio during a burst
+#define NET_TICK_MS 50
+
+// Bytes per packet, so a datagram fits one 1500-byte Ethernet frame
+#define NET_PACKET_SIZE 1400
+
+// UDP packets are built in a pool of buffers with room in front for lwIP
+// to write the UDP, IP and Ethernet headers into; MQTT only needs the one
+// packet being published
+#define NET_HEADROOM 64
+#define NET_BUFFERS 2
+#if NET_MQTT
+#define NET_ARENA_BYTES NET_PACKET_SIZE
+#else
+#define NET_ARENA_BYTES (NET_BUFFERS * (NET_HEADROOM + NET_PACKET_SIZE))
+#endif
+
+#define NET_MAGIC0 'T'
+#define NET_MAGIC1 'N'
+
+typedef struct __attribute__((packed)) {
+	uint8_t magic[2];
+	uint8_t board[8];  // unique id of the flash chip, to tell boards apart
+	uint32_t boot;     // flashlog_boot, which live sample times are relative to
+	uint16_t frames;   // telemetry frames that follow
+} net_header;
+
+/*
+ *	Takes the packet buffers from the arena and brings the radio up once to claim its PIO state machine and DMA channels
+ *
+ *	Call this before the display and sensors claim theirs, so they are still
+ *	free each time a burst powers the radio up again. The first net_poll
+ *	powers it down.
+ */
+void net_init();
+
+/*
+ *	Moves the current burst along, or starts one when it is due
+ *
+ *	Returns the time in milliseconds until it wants to be called again.
+ */
+uint32_t net_poll();
+
+/*
+ *	Returns true while the radio is powered or a burst is waiting to power it, when clk_sys has to be at full speed
+ */
+bool net_busy();
+
+/*
+ *	Prints counts of bursts, packets and samples sent, and the radio-on time
+ */
+void net_dump();
+
+#endif
@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <string.h>
+#include "pack.h"
+
+#define PACK_ESCAPE 15
+
+uint32_t pack_zigzag(int32_t value) {
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+int32_t pack_unzigzag(uint32_t value) {
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+uint pack_varint(uint8_t *out, uint32_t value) {
+	uint length = 0;
+	while (value >= 0x80) {
+		out[length++] = value | 0x80;
+		value >>= 7;
+	}
+	out[length++] = value;
+	return length;
+}
+
+/*
+ *	Reads a varint from the `length` bytes at `in`
+ *
+ *	Returns the number of bytes read, or 0 if it is cut short or longer than 32 bits.
+ */
+uint unpack_varint(const uint8_t *in, uint length, uint32_t *value) {
+	*value = 0;
+	for (uint i = 0; i < length && i < 5; ++i) {
+		*value |= (uint32_t)(in[i] & 0x7f) << (7 * i);
+		if (!(in[i] & 0x80)) {
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+uint pack_sample(pack_state *state, const history_sample *sample, uint8_t *out) {
+	uint length;
+	if (state->count == 0) {
+		memcpy(out, sample, sizeof(*sample));
+		length = sizeof(*sample);
+		state->delta_ms = 0;
+	} else {
+		uint32_t delta = sample->time_ms - state->time_ms;
+		length = pack_varint(out, pack_zigzag((int32_t)(delta - state->delta_ms)));
+		state->delta_ms = delta;
+
+		uint32_t temp = pack_zigzag(sample->temp_tenths - state->temp_tenths);
+		uint32_t humidity = pack_zigzag((int32_t)sample->humidity_tenths - (int32_t)state->humidity_tenths);
+		uint8_t *nibbles = &out[length++];
+		*nibbles = (MIN(temp, PACK_ESCAPE) << 4) | MIN(humidity, PACK_ESCAPE);
+		if (temp >= PACK_ESCAPE) {
+			length += pack_varint(out + length, temp);
+		}
+		if (humidity >= PACK_ESCAPE) {
+			length += pack_varint(out + length, humidity);
+		}
+	}
+	state->time_ms = sample->time_ms;
+	state->temp_tenths = sample->temp_tenths;
+	state->humidity_tenths = sample->humidity_tenths;
+	++state->count;
+	return length;
+}
+
+uint unpack_sample(pack_state *state, const uint8_t *in, uint length, history_sample *sample) {
+	uint used;
+	if (state->count == 0) {
+		if (length < sizeof(*sample)) {
+			return 0;
+		}
+		memcpy(sample, in, sizeof(*sample));
+		used = sizeof(*sample);
+		state->delta_ms = 0;
+	} else {
+		uint32_t value;
+		if (!(used = unpack_varint(in, length, &value)) || used == length) {
+			return 0;
+		}
+		state->delta_ms += pack_unzigzag(value);
+		sample->time_ms = state->time_ms + state->delta_ms;
+
+		uint8_t nibbles = in[used++];
+		uint32_t changes[2] = {nibbles >> 4, nibbles & 0xf};
+		for (uint i = 0; i < 2; ++i) {
+			if (changes[i] == PACK_ESCAPE) {
+				uint n = unpack_varint(in + used, length - used, &changes[i]);
+				if (!n) {
+					return 0;
+				}
+				used += n;
+			}
+		}
+		sample->temp_tenths = state->temp_tenths + pack_unzigzag(changes[0]);
+		sample->humidity_tenths = state->humidity_tenths + pack_unzigzag(changes[1]);
+	}
+	state->time_ms = sample->time_ms;
+	state->temp_tenths = sample->temp_tenths;
+	state->humidity_tenths = sample->humidity_tenths;
+	++state->count;
+	return used;
+}
+
+uint pack_history(uint sensor, uint32_t index, uint8_t *out, uint size, uint *count) {
+	pack_state state = {0};
+	uint length = 0;
+	*count = 0;
+	while (1) {
+		// the ring hands samples out a span at a time, up to where it wraps
+		const history_sample *span;
+		uint spanned = history_span(sensor, index + *count, HISTORY_SIZE, &span);
+		if (spanned == 0) {
+			return length;
+		}
+		for (uint i = 0; i < spanned; ++i) {
+			// pack where there is room for the worst case, or to the side to
+			// see if it fits
+			uint8_t scratch[PACK_MAX_SAMPLE];
+			pack_state next = state;
+			bool roomy = size - length >= PACK_MAX_SAMPLE;
+			uint packed = pack_sample(&next, &span[i], roomy ? out + length : scratch);
+			if (!roomy) {
+				if (packed > size - length) {
+					return length;
+				}
+				memcpy(out + length, scratch, packed);
+			}
+			state = next;
+			length += packed;
+			++*count;
+		}
+	}
+}
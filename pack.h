@@ -0,0 +1,60 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _PACK_H
+#define _PACK_H
+
+#include "pico/stdlib.h"
+#include "history.h"
+
+// Samples of one sensor packed into a block that decodes on its own:
+//
+//	first sample    8 bytes  history_sample as is
+//	each one after  varint   zigzag of the change in time since the previous
+//	                         sample from the time between the two before
+//	                1 byte   zigzag of the temperature change in the high
+//	                         nibble and of the humidity change in the low one
+//	                varints  the zigzag of each change whose nibble is 15
+//
+// Varints are 7 bits a byte, least significant first, with the top bit set
+// on all but the last byte. At a steady rate with readings moving a few
+// tenths at a time, a sample takes 2 bytes rather than 8.
+
+// Most bytes a sample can pack to
+#define PACK_MAX_SAMPLE 12
+
+// Where a block has got to, so the next sample can be packed or unpacked;
+// all zeros starts a new block
+typedef struct {
+	uint32_t count;         // samples in the block so far
+	uint32_t time_ms;
+	uint32_t delta_ms;      // time between the last two samples
+	int16_t temp_tenths;
+	uint16_t humidity_tenths;
+} pack_state;
+
+/*
+ *	Packs `sample` into `out`, which must have room for PACK_MAX_SAMPLE bytes, as the next one of the block at `state`
+ *
+ *	Returns the number of bytes written.
+ */
+uint pack_sample(pack_state *state, const history_sample *sample, uint8_t *out);
+
+/*
+ *	Unpacks the next sample of the block at `state` from the `length` bytes at `in`
+ *
+ *	Returns the number of bytes read, or 0 if they end part way through a sample.
+ */
+uint unpack_sample(pack_state *state, const uint8_t *in, uint length, history_sample *sample);
+
+/*
+ *	Packs as many samples of `sensor` as fit in `size` bytes into one block, starting from history index `index`
+ *
+ *	Returns the number of bytes written, and the number of samples in `count`.
+ */
+uint pack_history(uint sensor, uint32_t index, uint8_t *out, uint size, uint *count);
+
+#endif
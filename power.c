@@ -0,0 +1,129 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdio.h>
+#include "power.h"
+#include "dht.h"
+#include "display.h"
+#include "hardware/clocks.h"
+#include "hardware/pll.h"
+#if SYS_CLOCK_KHZ > POWER_RATED_KHZ
+#include "hardware/vreg.h"
+#endif
+
+static uint32_t full_khz;
+static bool low = false;
+
+// Time of the wake-up event waiting for the display
+static uint32_t wake_start_us;
+static bool waking = false;
+
+static uint32_t wakes = 0;
+static uint32_t last_latency_us = 0;
+static uint32_t max_latency_us = 0;
+
+/*
+ *	Lets everything clocked from clk_sys catch up with a new frequency
+ */
+void power_clock_changed() {
+	dht_clock_changed();
+	display_clock_changed();
+}
+
+void power_init() {
+#if SYS_CLOCK_KHZ
+#if SYS_CLOCK_KHZ > POWER_RATED_KHZ
+	// let the regulator settle before the faster clock needs it
+	vreg_set_voltage(VREG_VOLTAGE_1_15);
+	busy_wait_us(1000);
+#endif
+	set_sys_clock_khz(SYS_CLOCK_KHZ, true);
+#endif
+	full_khz = clock_get_hz(clk_sys) / KHZ;
+}
+
+/*
+ *	Panics unless the rate of `name` is within 1 in POWER_RATE_TOLERANCE of `expected_hz`
+ */
+void power_check_rate(const char *name, uint32_t hz, uint32_t expected_hz) {
+	uint32_t slack = expected_hz / POWER_RATE_TOLERANCE;
+	if (hz + slack < expected_hz || hz > expected_hz + slack) {
+		panic("%s runs at %lu Hz rather than %lu Hz with clk_sys at %lu kHz", name, (unsigned long)hz,
+			(unsigned long)expected_hz, (unsigned long)(clock_get_hz(clk_sys) / KHZ));
+	}
+}
+
+/*
+ *	Checks the subsystems timed from clk_sys against their rates, with clk_sys meant to be at `khz`
+ */
+void power_check_clock(uint32_t khz) {
+	// the frequency counter measures clk_sys against clk_ref, from the crystal
+	power_check_rate("clk_sys", frequency_count_khz(CLOCKS_FC0_SRC_VALUE_CLK_SYS) * KHZ, khz * KHZ);
+	power_check_rate("DHT capture", dht_rate_hz(), DHT_RATE_HZ);
+	power_check_rate("display scanner", display_rate_hz(), DISPLAY_RATE_HZ);
+}
+
+void power_check(bool lowered) {
+	power_check_clock(full_khz);
+#if LOW_POWER
+	if (lowered) {
+		power_low();
+		power_check_clock(POWER_LOW_KHZ);
+		power_full();
+		power_check_clock(full_khz);
+	}
+#endif
+}
+
+void power_low() {
+#if LOW_POWER
+	if (low) {
+		return;
+	}
+	clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX, CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB,
+		48 * MHZ, POWER_LOW_KHZ * KHZ);
+	clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS, POWER_LOW_KHZ * KHZ, POWER_LOW_KHZ * KHZ);
+	pll_deinit(pll_sys);
+	low = true;
+	power_clock_changed();
+#endif
+}
+
+void power_full() {
+	if (!low) {
+		return;
+	}
+
+	// restarts the system PLL and waits for it to lock, well under a millisecond
+	set_sys_clock_khz(full_khz, true);
+	low = false;
+	power_clock_changed();
+}
+
+bool power_is_low() {
+	return low;
+}
+
+void power_wake(uint32_t start_us) {
+	wake_start_us = start_us;
+	waking = true;
+}
+
+void power_wake_shown() {
+	if (!waking) {
+		return;
+	}
+	last_latency_us = time_us_32() - wake_start_us;
+	max_latency_us = MAX(max_latency_us, last_latency_us);
+	++wakes;
+	waking = false;
+}
+
+void power_dump() {
+	printf("clk_sys %lu kHz, full speed %lu kHz\n", (unsigned long)(clock_get_hz(clk_sys) / KHZ), (unsigned long)full_khz);
+	printf("wake to display: %lu wakes, last %lu us, max %lu us\n", (unsigned long)wakes,
+		(unsigned long)last_latency_us, (unsigned long)max_latency_us);
+}
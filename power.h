@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _POWER_H
+#define _POWER_H
+
+#include "pico/stdlib.h"
+
+// clk_sys while the display is off, run straight from PLL_USB so the system
+// PLL can be stopped; 48 MHz is also the slowest clock USB is happy with
+#define POWER_LOW_KHZ 48000
+
+// clk_sys at full speed, set by the clock variants of the build; 0 keeps
+// the SDK's default
+#ifndef SYS_CLOCK_KHZ
+#define SYS_CLOCK_KHZ 0
+#endif
+
+#if SYS_CLOCK_KHZ && SYS_CLOCK_KHZ < POWER_LOW_KHZ
+#error "SYS_CLOCK_KHZ must be at least POWER_LOW_KHZ, the slowest clock USB is happy with"
+#endif
+
+// Clocks above the RP2040's rated 133 MHz get a little more core voltage
+#define POWER_RATED_KHZ 133000
+
+// Rates timed from clk_sys may be off by 1 part in this many
+#define POWER_RATE_TOLERANCE 50
+
+/*
+ *	Sets clk_sys to SYS_CLOCK_KHZ, if given, and remembers the frequency to come back to
+ *
+ *	Call this first thing, before anything is timed from clk_sys.
+ */
+void power_init();
+
+/*
+ *	Checks that clk_sys runs as set and every subsystem timed from it has followed, panicking if not
+ *
+ *	Call this once the display and sensors are initialised and before any
+ *	read starts. With `lowered`, and a build with LOW_POWER, the lowered
+ *	clock is tried too, and clk_sys is back at full speed afterwards.
+ */
+void power_check(bool lowered);
+
+/*
+ *	Drops clk_sys to POWER_LOW_KHZ and stops the system PLL
+ *
+ *	Only call this while no sensor read is in progress. Does nothing unless
+ *	built with LOW_POWER.
+ */
+void power_low();
+
+/*
+ *	Brings clk_sys back to full speed, if it was lowered
+ *
+ *	Only call this while no sensor read is in progress.
+ */
+void power_full();
+
+/*
+ *	Returns true while clk_sys is lowered
+ */
+bool power_is_low();
+
+/*
+ *	Notes that a wake-up event happened at `start_us`, from time_us_32
+ */
+void power_wake(uint32_t start_us);
+
+/*
+ *	Notes that the display has been updated, measuring the latency of a pending wake-up
+ */
+void power_wake_shown();
+
+/*
+ *	Prints clk_sys and the latest and worst wake-to-display latencies
+ */
+void power_dump();
+
+#endif
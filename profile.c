@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdio.h>
+#include "profile.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+
+// Running statistics of one code path
+typedef struct {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	uint32_t histogram[PROFILE_BUCKETS];
+} profile_entry;
+
+static const char *PROFILE_NAMES[PROFILE_COUNT] = {
+	[PROFILE_READ] = "read",
+	[PROFILE_DECODE] = "decode",
+	[PROFILE_CAPTURE_IRQ] = "capture_irq",
+#if !DISPLAY_PIO
+	[PROFILE_DISPLAY_DIGIT] = "display_digit",
+#endif
+	[PROFILE_SHOW_SAMPLE] = "show_sample",
+	[PROFILE_READ_DONE] = "read_done",
+};
+
+// Each path only ever runs on one core, so entries are never shared between cores
+static profile_entry entries[PROFILE_COUNT];
+
+void profile_init() {
+	systick_hw->rvr = 0xffffff;
+	systick_hw->cvr = 0;
+	systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+void __not_in_flash_func(profile_record)(profile_id id, uint32_t start) {
+	uint32_t cycles = (start - profile_now()) & 0xffffff;
+
+	uint bucket = 0;
+	while ((cycles >> bucket) > 1 && bucket < PROFILE_BUCKETS - 1) {
+		++bucket;
+	}
+
+	// IRQ handlers record too, so keep each update whole
+	uint32_t status = save_and_disable_interrupts();
+	profile_entry *entry = &entries[id];
+	if (entry->count == 0 || cycles < entry->min) entry->min = cycles;
+	if (cycles > entry->max) entry->max = cycles;
+	entry->total += cycles;
+	++entry->count;
+	++entry->histogram[bucket];
+	restore_interrupts(status);
+}
+
+void profile_dump() {
+	uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+	printf("path count min max mean (cycles at %lu MHz)\n", (unsigned long)mhz);
+
+	for (uint i = 0; i < PROFILE_COUNT; ++i) {
+		// copy so the numbers stay consistent while printing
+		uint32_t status = save_and_disable_interrupts();
+		profile_entry entry = entries[i];
+		restore_interrupts(status);
+
+		uint32_t mean = entry.count ? (uint32_t)(entry.total / entry.count) : 0;
+		printf("%s %lu %lu %lu %lu\n", PROFILE_NAMES[i], (unsigned long)entry.count,
+			(unsigned long)entry.min, (unsigned long)entry.max, (unsigned long)mean);
+
+		// bucket b counts spans of 2^b to 2^(b+1) - 1 cycles
+		printf("  histogram");
+		for (uint b = 0; b < PROFILE_BUCKETS; ++b) {
+			printf(" %lu", (unsigned long)entry.histogram[b]);
+		}
+		printf("\n");
+	}
+}
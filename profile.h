@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include "pico/stdlib.h"
+
+// Profiled code paths; only the thermometer_profile target records them
+typedef enum {
+	PROFILE_READ,           // whole DHT read, from request to result
+	PROFILE_DECODE,         // checksum and conversion of a captured frame
+	PROFILE_CAPTURE_IRQ,    // DHT capture backend IRQ handler
+#if !DISPLAY_PIO
+	PROFILE_DISPLAY_DIGIT,  // one step of the core 1 display scan; the PIO scanner has no CPU steps
+#endif
+	PROFILE_SHOW_SAMPLE,    // rendering a sample to the framebuffer
+	PROFILE_READ_DONE,      // storing a new sample
+	PROFILE_COUNT,
+} profile_id;
+
+// Log2 buckets of elapsed cycles; the last one also counts anything longer
+#define PROFILE_BUCKETS 24
+
+#if PROFILE
+#include "hardware/structs/systick.h"
+
+/*
+ *	Returns the current SysTick count; it counts down once per clk_sys cycle
+ */
+static inline uint32_t profile_now() {
+	return systick_hw->cvr;
+}
+
+/*
+ *	Starts the SysTick counter of the calling core
+ */
+void profile_init();
+
+/*
+ *	Records the cycles elapsed since `start`, a value returned by profile_now on the same core
+ *
+ *	Spans must be shorter than 2^24 cycles (134 ms at 125 MHz). Runs from
+ *	SRAM, so it does not stretch the core 1 display scanner's digits.
+ */
+void profile_record(profile_id id, uint32_t start);
+
+/*
+ *	Prints min/max/mean and the histogram of every path over stdio
+ */
+void profile_dump();
+
+#define PROFILE_ENTER(id) uint32_t profile_start_##id = profile_now()
+#define PROFILE_EXIT(id) profile_record(id, profile_start_##id)
+#else
+#define PROFILE_ENTER(id)
+#define PROFILE_EXIT(id)
+#endif
+
+#endif
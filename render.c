@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdio.h>
+#include "render.h"
+#include "derived.h"
+#include "dht.h"
+#include "display.h"
+
+static const char *const RENDER_LABELS[RENDER_MODES] = {
+	[RENDER_TEMP_HUMIDITY] = "t  h",
+	[RENDER_TEMP] = "tEnP",
+	[RENDER_HUMIDITY] = "hUn ",
+	[RENDER_DEW_POINT] = "dEuP",
+	[RENDER_HEAT_INDEX] = "HEAt",
+};
+
+/*
+ *	Rounds tenths to the nearest whole number, halves away from zero
+ */
+int render_round(int tenths) {
+	return (tenths + ((tenths < 0) ? -5 : 5)) / 10;
+}
+
+/*
+ *	Puts a whole number into two digits from `selector`, or "Lo" / "Hi" if it does not fit
+ */
+void render_two(uint selector, int value) {
+	if (value < -9) {
+		set_char(selector, 'L');
+		set_char(selector + 1, 'o');
+	} else if (value > 99) {
+		set_char(selector, 'H');
+		set_char(selector + 1, 'I');
+	} else if (value < 0) {
+		set_char(selector, '-');
+		set_digit(selector + 1, -value);
+	} else {
+		set_char(selector, value >= 10 ? '0' + value / 10 : ' ');
+		set_digit(selector + 1, value % 10);
+	}
+}
+
+void render_fixed(int tenths, char unit) {
+	uint magnitude = (tenths < 0) ? -tenths : tenths;
+	set_char(3, unit);
+
+	if (tenths > -100 && tenths < 1000) {
+		// one decimal: the point lights on the units digit
+		set_char(0, (tenths < 0) ? '-' : (magnitude >= 100) ? '0' + magnitude / 100 : ' ');
+		set_segments(1, display_glyph('0' + (magnitude / 10) % 10) | SEG_P);
+		set_digit(2, magnitude % 10);
+		return;
+	}
+
+	int value = render_round(tenths);
+	if (value < -99 || value > 999) {
+		set_char(0, ' ');
+		set_char(1, (value < 0) ? 'L' : 'H');
+		set_char(2, (value < 0) ? 'o' : 'I');
+		return;
+	}
+	magnitude = (value < 0) ? -value : value;
+	set_char(0, (value < 0) ? '-' : '0' + magnitude / 100);
+	set_digit(1, (magnitude / 10) % 10);
+	set_digit(2, magnitude % 10);
+}
+
+/*
+ *	Returns the value in tenths that `mode` shows with render_fixed, and its unit in `unit`
+ */
+int render_value(render_mode mode, bool fahrenheit, int temp_tenths, uint humidity_tenths, char *unit) {
+	*unit = fahrenheit ? 'F' : 'C';
+	int value;
+	switch (mode) {
+	case RENDER_HUMIDITY:
+		*unit = 'h';
+		return humidity_tenths;
+	case RENDER_DEW_POINT:
+		value = derived_dew_point(temp_tenths, humidity_tenths);
+		break;
+	case RENDER_HEAT_INDEX:
+		value = derived_heat_index(temp_tenths, humidity_tenths);
+		break;
+	default:
+		value = temp_tenths;
+		break;
+	}
+	return fahrenheit ? dht_celsius_to_fahrenheit(value) : value;
+}
+
+void render_reading(render_mode mode, bool fahrenheit, int temp_tenths, uint humidity_tenths) {
+	if (mode == RENDER_TEMP_HUMIDITY) {
+		render_two(0, render_round(fahrenheit ? dht_celsius_to_fahrenheit(temp_tenths) : temp_tenths));
+		render_two(2, MIN(render_round(humidity_tenths), 99));
+		return;
+	}
+	char unit;
+	int value = render_value(mode, fahrenheit, temp_tenths, humidity_tenths, &unit);
+	render_fixed(value, unit);
+}
+
+bool render_reading_text(render_mode mode, bool fahrenheit, int temp_tenths, uint humidity_tenths, char *text, uint size) {
+	if (mode == RENDER_TEMP_HUMIDITY) {
+		int temp = render_round(fahrenheit ? dht_celsius_to_fahrenheit(temp_tenths) : temp_tenths);
+		if (temp >= -9 && temp <= 99) {
+			return false;
+		}
+		snprintf(text, size, "%d%c %uh", temp, fahrenheit ? 'F' : 'C', MIN(render_round(humidity_tenths), 99));
+		return true;
+	}
+
+	char unit;
+	int value = render_value(mode, fahrenheit, temp_tenths, humidity_tenths, &unit);
+	if (value > -100 && value < 1000) {
+		return false;
+	}
+	uint magnitude = (value < 0) ? -value : value;
+	snprintf(text, size, "%s%u.%u%c", (value < 0) ? "-" : "", magnitude / 10, magnitude % 10, unit);
+	return true;
+}
+
+void render_label(render_mode mode) {
+	for (uint i = 0; i < 4; ++i) {
+		set_char(i, RENDER_LABELS[mode][i]);
+	}
+}
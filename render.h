@@ -0,0 +1,54 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _RENDER_H
+#define _RENDER_H
+
+#include "pico/stdlib.h"
+
+// What the display shows of a reading
+typedef enum {
+	RENDER_TEMP_HUMIDITY,  // two digits of temperature, two of humidity
+	RENDER_TEMP,           // temperature with a tenth and its unit
+	RENDER_HUMIDITY,       // humidity with a tenth, then 'h'
+	RENDER_DEW_POINT,
+	RENDER_HEAT_INDEX,
+	RENDER_MODES,
+} render_mode;
+
+/*
+ *	Puts a reading into the display's back buffer in `mode`; the caller publishes it with display_show
+ *
+ *	Temperatures are shown in fahrenheit or, with `fahrenheit` false, celsius.
+ */
+void render_reading(render_mode mode, bool fahrenheit, int temp_tenths, uint humidity_tenths);
+
+// Longest text render_reading_text writes, with its terminator
+#define RENDER_TEXT_MAX 16
+
+/*
+ *	Writes the whole of a reading that render_reading cannot fit in four digits to `text`, to be scrolled
+ *
+ *	Returns false, leaving `text` alone, if render_reading shows all of it:
+ *	every tenth of the modes that show one, and a temperature from -9 to 99
+ *	with the humidity.
+ */
+bool render_reading_text(render_mode mode, bool fahrenheit, int temp_tenths, uint humidity_tenths, char *text, uint size);
+
+/*
+ *	Puts the four-character label of `mode` into the back buffer
+ */
+void render_label(render_mode mode);
+
+/*
+ *	Puts a signed value in tenths into the first three digits, then `unit` in the last
+ *
+ *	Shows a tenth after the decimal point wherever it fits, so -9.9 to 99.9,
+ *	then whole numbers down to -99 and up to 999, and "Lo" or "Hi" beyond.
+ */
+void render_fixed(int tenths, char unit);
+
+#endif
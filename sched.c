@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "sched.h"
+#include "hardware/sync.h"
+
+static sched_handler handlers[SCHED_MAX_EVENTS];
+static volatile uint32_t pending = 0;
+
+void sched_on(uint event, sched_handler handler) {
+	handlers[event] = handler;
+}
+
+void sched_post(uint event) {
+	uint32_t status = save_and_disable_interrupts();
+	pending |= 1u << event;
+	restore_interrupts(status);
+
+	// wake the scheduler if it is waiting on another core's event
+	__sev();
+}
+
+int64_t sched_alarm_callback(alarm_id_t id, void *user_data) {
+	sched_post((uint)(uintptr_t)user_data);
+	return 0;
+}
+
+alarm_id_t sched_post_in_ms(uint event, uint32_t ms) {
+	return add_alarm_in_ms(ms, sched_alarm_callback, (void *)(uintptr_t)event, true);
+}
+
+void sched_cancel(alarm_id_t id) {
+	if (id > 0) {
+		cancel_alarm(id);
+	}
+}
+
+bool sched_timer_callback(repeating_timer_t *timer) {
+	sched_post((uint)(uintptr_t)timer->user_data);
+	return true;
+}
+
+bool sched_every_ms(uint event, uint32_t ms, repeating_timer_t *timer) {
+	return add_repeating_timer_ms(ms, sched_timer_callback, (void *)(uintptr_t)event, timer);
+}
+
+void sched_run() {
+	while (1) {
+		// take every pending event at once
+		uint32_t status = save_and_disable_interrupts();
+		uint32_t events = pending;
+		pending = 0;
+		restore_interrupts(status);
+
+		if (!events) {
+			// posts from IRQs and SEV both end the wait, so nothing is missed
+			__wfe();
+			continue;
+		}
+
+		for (uint i = 0; i < SCHED_MAX_EVENTS; ++i) {
+			if ((events & (1u << i)) && handlers[i]) {
+				handlers[i]();
+			}
+		}
+	}
+}
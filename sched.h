@@ -0,0 +1,49 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _SCHED_H
+#define _SCHED_H
+
+#include "pico/stdlib.h"
+
+// Most events the scheduler can track; each event is one bit of a mask
+#define SCHED_MAX_EVENTS 32
+
+typedef void (*sched_handler)(void);
+
+/*
+ *	Sets the handler run by sched_run whenever `event` is posted
+ */
+void sched_on(uint event, sched_handler handler);
+
+/*
+ *	Marks `event` as pending and wakes the scheduler; safe to call from IRQs
+ */
+void sched_post(uint event);
+
+/*
+ *	Posts `event` once after `ms` milliseconds
+ *
+ *	Returns an alarm id that can be passed to sched_cancel.
+ */
+alarm_id_t sched_post_in_ms(uint event, uint32_t ms);
+
+/*
+ *	Cancels an event scheduled by sched_post_in_ms, if it has not fired yet
+ */
+void sched_cancel(alarm_id_t id);
+
+/*
+ *	Posts `event` every `ms` milliseconds using `timer` for storage
+ */
+bool sched_every_ms(uint event, uint32_t ms, repeating_timer_t *timer);
+
+/*
+ *	Runs pending event handlers forever, sleeping with WFE whenever none are pending
+ */
+void sched_run();
+
+#endif
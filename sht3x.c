@@ -0,0 +1,303 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include "dht_backend.h"
+#include "crc.h"
+#include "profile.h"
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+// SHT3x backend: each sensor measures continuously at 10 Hz, and a read
+// fetches its latest measurement with one I2C transaction driven by DMA, so
+// the CPU only sees the completion IRQ. A sensor is given by the SDA pin of
+// its bus, with SCL on the next pin; a second sensor on the same bus has its
+// ADDR pin pulled high.
+
+// Every SDA pin is even and sets its SCL pin beside it in the pin mask, and
+// SDA pins alternate between I2C0 and I2C1 every pair, so each block's SDA
+// pins are every fourth bit; a block has one bus, so one of them at most
+#ifdef DHT_PIN_MASK
+#if ((DHT_PIN_MASK & 0x15555555u) << 1) != (DHT_PIN_MASK & 0x2aaaaaaau) || (DHT_PIN_MASK >> 30)
+#error "DHT_PINS must list even SDA pins from 0 to 28 for the SHT3x, with SCL on the next pin"
+#endif
+#if (DHT_PIN_MASK & 0x11111111u) & ((DHT_PIN_MASK & 0x11111111u) - 1)
+#error "DHT_PINS puts two SHT3x buses on I2C0; use one SDA pin per I2C block"
+#endif
+#if (DHT_PIN_MASK & 0x04444444u) & ((DHT_PIN_MASK & 0x04444444u) - 1)
+#error "DHT_PINS puts two SHT3x buses on I2C1; use one SDA pin per I2C block"
+#endif
+#endif
+
+#define SHT3X_ADDRESS 0x44
+#define SHT3X_BAUD_HZ 400000
+
+// Commands, sent most significant byte first
+#define SHT3X_BREAK 0x3093
+#define SHT3X_PERIODIC_10HZ 0x2737  // 10 measurements a second, high repeatability
+#define SHT3X_FETCH 0xe000
+
+// A measurement: the temperature and humidity words, each followed by its CRC
+#define SHT3X_FRAME_BYTES 6
+
+// Failed reads in a row after which the periodic measurement is started
+// again, in case the sensor has been power cycled
+#define SHT3X_RESTART_FAILURES 2
+
+// One I2C block and the transaction on it
+typedef struct {
+	i2c_inst_t *i2c;
+	uint sda_pin;
+	uint sensors;
+	uint tx_dma;
+	uint rx_dma;
+	uint baud_hz;      // what the divider gives at the current clk_sys
+	int active;        // sensor whose transaction is on the bus, or -1
+	uint32_t waiting;  // sensors queued behind it
+} sht3x_bus;
+
+// Capture state of one sensor
+typedef struct {
+	sht3x_bus *bus;
+	uint8_t address;
+	uint failures;
+	bool restart;           // send the periodic command instead of the next fetch
+	volatile bool fetched;  // the frame has arrived since the read started
+	uint8_t frame[SHT3X_FRAME_BYTES];
+} sht3x_channel;
+
+static sht3x_bus buses[NUM_I2CS];
+static sht3x_channel channels[DHT_SENSOR_COUNT];
+
+// Words the TX channel writes to IC_DATA_CMD; a fetch is the command, then
+// a read of each byte after a repeated start, ending with a stop. They are
+// kept in RAM, where DMA can reach them while flash is busy.
+#define SHT3X_READ I2C_IC_DATA_CMD_CMD_BITS
+static uint32_t fetch_words[] = {
+	SHT3X_FETCH >> 8,
+	SHT3X_FETCH & 0xff,
+	SHT3X_READ | I2C_IC_DATA_CMD_RESTART_BITS,
+	SHT3X_READ,
+	SHT3X_READ,
+	SHT3X_READ,
+	SHT3X_READ,
+	SHT3X_READ | I2C_IC_DATA_CMD_STOP_BITS,
+};
+static uint32_t periodic_words[] = {
+	SHT3X_PERIODIC_10HZ >> 8,
+	(SHT3X_PERIODIC_10HZ & 0xff) | I2C_IC_DATA_CMD_STOP_BITS,
+};
+
+_Static_assert(count_of(fetch_words) == 2 + SHT3X_FRAME_BYTES, "a fetch reads the whole frame");
+
+/*
+ *	Sends a command to a sensor, blocking; only used at startup
+ */
+bool sht3x_command(const sht3x_channel *ch, uint16_t command) {
+	const uint8_t bytes[2] = {command >> 8, command & 0xff};
+	return i2c_write_timeout_us(ch->bus->i2c, ch->address, bytes, sizeof(bytes), false, 1000) == sizeof(bytes);
+}
+
+/*
+ *	Puts a sensor's transaction on its bus, which must be free
+ */
+void sht3x_begin(uint sensor) {
+	sht3x_channel *ch = &channels[sensor];
+	sht3x_bus *bus = ch->bus;
+	i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+	bus->active = sensor;
+
+	// the target address can only change while the block is disabled; this
+	// also clears an abort or bytes left behind by a failed transaction
+	hw->enable = 0;
+	hw->tar = ch->address;
+	hw->enable = 1;
+	(void)hw->clr_tx_abrt;
+
+	if (ch->restart) {
+		// write only; the retry after the next measurement fetches it
+		ch->restart = false;
+		dma_channel_transfer_from_buffer_now(bus->tx_dma, periodic_words, count_of(periodic_words));
+	} else {
+		dma_channel_transfer_to_buffer_now(bus->rx_dma, ch->frame, SHT3X_FRAME_BYTES);
+		dma_channel_transfer_from_buffer_now(bus->tx_dma, fetch_words, count_of(fetch_words));
+	}
+	dht_on_preamble(sensor);
+}
+
+/*
+ *	DMA IRQ: a sensor's frame has been read
+ */
+void sht3x_dma_irq() {
+	for (uint i = 0; i < NUM_I2CS; ++i) {
+		sht3x_bus *bus = &buses[i];
+		if (!bus->sensors || !dma_channel_get_irq0_status(bus->rx_dma)) {
+			continue;
+		}
+		dma_channel_acknowledge_irq0(bus->rx_dma);
+		PROFILE_ENTER(PROFILE_CAPTURE_IRQ);
+		if (bus->active >= 0) {
+			channels[bus->active].fetched = true;
+			dht_on_frame(bus->active);
+		}
+		PROFILE_EXIT(PROFILE_CAPTURE_IRQ);
+	}
+}
+
+void sht3x_bus_init(sht3x_bus *bus, uint index, uint sda_pin) {
+	bus->i2c = index ? i2c1 : i2c0;
+	bus->sda_pin = sda_pin;
+	bus->active = -1;
+	bus->baud_hz = i2c_init(bus->i2c, SHT3X_BAUD_HZ);
+	gpio_set_function(sda_pin, GPIO_FUNC_I2C);
+	gpio_set_function(sda_pin + 1, GPIO_FUNC_I2C);
+	gpio_pull_up(sda_pin);
+	gpio_pull_up(sda_pin + 1);
+
+	i2c_hw_t *hw = i2c_get_hw(bus->i2c);
+	hw->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+
+	bus->tx_dma = dma_claim_unused_channel(true);
+	dma_channel_config c = dma_channel_get_default_config(bus->tx_dma);
+	channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+	channel_config_set_dreq(&c, i2c_get_dreq(bus->i2c, true));
+	dma_channel_configure(bus->tx_dma, &c, &hw->data_cmd, fetch_words, 0, false);
+
+	bus->rx_dma = dma_claim_unused_channel(true);
+	c = dma_channel_get_default_config(bus->rx_dma);
+	channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+	channel_config_set_read_increment(&c, false);
+	channel_config_set_write_increment(&c, true);
+	channel_config_set_dreq(&c, i2c_get_dreq(bus->i2c, false));
+	dma_channel_configure(bus->rx_dma, &c, NULL, &hw->data_cmd, 0, false);
+	dma_channel_set_irq0_enabled(bus->rx_dma, true);
+}
+
+void dht_backend_init(const uint *pins, uint count) {
+	for (uint i = 0; i < count; ++i) {
+		// SDA is on even pins, alternating between the two blocks every pair
+		uint sda_pin = pins[i];
+		if (sda_pin % 2 || sda_pin + 1 >= NUM_BANK0_GPIOS) {
+			panic("SHT3x pin %u is not an I2C SDA pin", sda_pin);
+		}
+		sht3x_bus *bus = &buses[(sda_pin / 2) % NUM_I2CS];
+		if (!bus->sensors) {
+			sht3x_bus_init(bus, (sda_pin / 2) % NUM_I2CS, sda_pin);
+		} else if (bus->sda_pin != sda_pin) {
+			panic("SHT3x pin %u is on the same I2C block as pin %u", sda_pin, bus->sda_pin);
+		} else if (bus->sensors == 2) {
+			panic("at most two SHT3x sensors fit on one bus");
+		}
+
+		sht3x_channel *ch = &channels[i];
+		ch->bus = bus;
+		ch->address = SHT3X_ADDRESS + bus->sensors++;
+
+		// stop any measurement left running from before a reset, then start
+		// the periodic one; a sensor that does not answer yet is retried
+		// from its first failed reads
+		sht3x_command(ch, SHT3X_BREAK);
+		sleep_ms(1);
+		ch->restart = !sht3x_command(ch, SHT3X_PERIODIC_10HZ);
+	}
+
+	irq_add_shared_handler(DMA_IRQ_0, sht3x_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+	irq_set_enabled(DMA_IRQ_0, true);
+}
+
+void dht_backend_start(uint sensor) {
+	sht3x_channel *ch = &channels[sensor];
+	ch->fetched = false;
+
+	// sensors sharing a bus take turns
+	uint32_t status = save_and_disable_interrupts();
+	if (ch->bus->active >= 0) {
+		ch->bus->waiting |= 1u << sensor;
+	} else {
+		sht3x_begin(sensor);
+	}
+	restore_interrupts(status);
+}
+
+void dht_backend_stop(uint sensor) {
+	sht3x_channel *ch = &channels[sensor];
+	sht3x_bus *bus = ch->bus;
+
+	uint32_t status = save_and_disable_interrupts();
+	bus->waiting &= ~(1u << sensor);
+	if (bus->active != (int)sensor) {
+		restore_interrupts(status);
+		return;
+	}
+
+	// an abort can raise the channel's IRQ, so mask it meanwhile
+	dma_channel_abort(bus->tx_dma);
+	dma_channel_set_irq0_enabled(bus->rx_dma, false);
+	dma_channel_abort(bus->rx_dma);
+	dma_channel_acknowledge_irq0(bus->rx_dma);
+	dma_channel_set_irq0_enabled(bus->rx_dma, true);
+
+	// a sensor that keeps not answering, usually by NACKing the fetch, may
+	// have lost its periodic measurement
+	if (!ch->fetched && ++ch->failures >= SHT3X_RESTART_FAILURES) {
+		ch->failures = 0;
+		ch->restart = true;
+	}
+
+	bus->active = -1;
+	if (bus->waiting) {
+		uint next = __builtin_ctz(bus->waiting);
+		bus->waiting &= ~(1u << next);
+		sht3x_begin(next);
+	}
+	restore_interrupts(status);
+}
+
+void dht_backend_clock_changed() {
+	// the baud rate divider runs from clk_sys
+	for (uint i = 0; i < NUM_I2CS; ++i) {
+		if (buses[i].sensors) {
+			buses[i].baud_hz = i2c_set_baudrate(buses[i].i2c, SHT3X_BAUD_HZ);
+		}
+	}
+}
+
+uint32_t dht_backend_rate_hz() {
+	// the slowest bus is the one to worry about
+	uint32_t rate = DHT_RATE_HZ;
+	for (uint i = 0; i < NUM_I2CS; ++i) {
+		if (buses[i].sensors) {
+			rate = MIN(rate, buses[i].baud_hz);
+		}
+	}
+	return rate;
+}
+
+uint dht_backend_captured(uint sensor) {
+	// a fetch arrives in one piece or not at all
+	return 0;
+}
+
+void dht_model_quality(uint sensor, dht_diag *diag) {
+	// there are no pulses to time on I2C
+}
+
+dht_status dht_model_decode(uint sensor, dht_reading *result) {
+	sht3x_channel *ch = &channels[sensor];
+	const uint8_t *frame = ch->frame;
+	if (crc8_update(CRC8_INIT, &frame[0], 2) != frame[2] || crc8_update(CRC8_INIT, &frame[3], 2) != frame[5]) {
+		return DHT_CHECKSUM;
+	}
+	ch->failures = 0;
+
+	// T = -45 + 175 * raw / 65535 C and RH = 100 * raw / 65535 %, rounded to tenths
+	uint32_t temp = (frame[0] << 8) | frame[1];
+	uint32_t humidity = (frame[3] << 8) | frame[4];
+	result->temp_tenths = (int)((temp * 1750 + 32767) / 65535) - 450;
+	result->humidity_tenths = (humidity * 1000 + 32767) / 65535;
+	return DHT_OK;
+}
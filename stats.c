@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <string.h>
+#include "stats.h"
+#include "arena.h"
+
+static const uint32_t STATS_WINDOWS[] = {STATS_WINDOWS_S};
+
+static stats_window (*windows)[STATS_WINDOW_COUNT];
+
+void stats_init() {
+	windows = arena_alloc(STATS_ARENA_BYTES);
+}
+
+stats_entry *stats_front(stats_deque *deque) {
+	return &deque->entries[deque->head];
+}
+
+stats_entry *stats_back(stats_deque *deque) {
+	return &deque->entries[(deque->head + deque->count - 1) % STATS_BUCKETS];
+}
+
+/*
+ *	Drops entries of buckets that have slid out of the window ending at `bucket`
+ */
+void stats_expire(stats_deque *deque, uint16_t bucket) {
+	while (deque->count && (uint16_t)(bucket - stats_front(deque)->bucket) >= STATS_BUCKETS) {
+		deque->head = (deque->head + 1) % STATS_BUCKETS;
+		--deque->count;
+	}
+}
+
+/*
+ *	Adds `value` to a min deque, or a max deque with `sign` -1
+ *
+ *	Entries the new value beats can never be the best again, so they go;
+ *	an entry of the same bucket that beats the new value already covers it.
+ */
+void stats_offer(stats_deque *deque, uint16_t bucket, int16_t value, int sign) {
+	while (deque->count && sign * stats_back(deque)->value >= sign * value) {
+		--deque->count;
+	}
+	if (deque->count && stats_back(deque)->bucket == bucket) {
+		return;
+	}
+	++deque->count;
+	*stats_back(deque) = (stats_entry){bucket, value};
+}
+
+void stats_window_push(stats_window *w, uint32_t length_ms, const history_sample *sample) {
+	const int16_t values[STATS_QUANTITIES] = {sample->temp_tenths, sample->humidity_tenths};
+	uint32_t bucket = sample->time_ms / (length_ms / STATS_BUCKETS);
+
+	if (w->count == 0 || bucket - w->bucket >= STATS_BUCKETS) {
+		// first sample, or the whole window has passed since the last one;
+		// start over, keeping the average to decay from
+		int32_t ewma[STATS_QUANTITIES];
+		memcpy(ewma, w->ewma, sizeof(ewma));
+		uint32_t last_time_ms = w->last_time_ms;
+		bool seeded = w->count != 0;
+		memset(w, 0, sizeof(*w));
+		for (uint q = 0; q < STATS_QUANTITIES; ++q) {
+			w->ewma[q] = seeded ? ewma[q] : values[q] * 65536;
+		}
+		w->last_time_ms = seeded ? last_time_ms : sample->time_ms;
+	} else {
+		// retire the buckets the window has slid past
+		for (; w->bucket != bucket; ++w->bucket) {
+			uint slot = (w->bucket + 1) % STATS_BUCKETS;
+			for (uint q = 0; q < STATS_QUANTITIES; ++q) {
+				w->sums[q] -= w->bucket_sums[q][slot];
+				w->bucket_sums[q][slot] = 0;
+			}
+			w->count -= w->bucket_counts[slot];
+			w->bucket_counts[slot] = 0;
+		}
+	}
+	w->bucket = bucket;
+
+	uint slot = bucket % STATS_BUCKETS;
+	uint32_t dt = MIN(sample->time_ms - w->last_time_ms, length_ms);
+	w->last_time_ms = sample->time_ms;
+	for (uint q = 0; q < STATS_QUANTITIES; ++q) {
+		w->sums[q] += values[q];
+		w->bucket_sums[q][slot] += values[q];
+
+		stats_expire(&w->min[q], bucket);
+		stats_expire(&w->max[q], bucket);
+		stats_offer(&w->min[q], bucket, values[q], 1);
+		stats_offer(&w->max[q], bucket, values[q], -1);
+
+		w->ewma[q] += ((int64_t)values[q] * 65536 - w->ewma[q]) * dt / length_ms;
+	}
+	++w->count;
+	++w->bucket_counts[slot];
+}
+
+uint32_t stats_window_s(uint window) {
+	return STATS_WINDOWS[window];
+}
+
+void stats_push(uint sensor, const history_sample *sample) {
+	for (uint i = 0; i < STATS_WINDOW_COUNT; ++i) {
+		stats_window_push(&windows[sensor][i], STATS_WINDOWS[i] * 1000, sample);
+	}
+}
+
+bool stats_get(uint sensor, uint window, stats_quantity quantity, stats_summary *summary) {
+	stats_window *w = &windows[sensor][window];
+	if (w->count == 0) {
+		return false;
+	}
+	summary->min = stats_front(&w->min[quantity])->value;
+	summary->max = stats_front(&w->max[quantity])->value;
+	int32_t half = (w->sums[quantity] < 0) ? -(int32_t)w->count / 2 : (int32_t)w->count / 2;
+	summary->mean = (w->sums[quantity] + half) / (int32_t)w->count;
+	summary->ewma = (w->ewma[quantity] + 32768) >> 16;
+	return true;
+}
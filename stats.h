@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include "pico/stdlib.h"
+#include "arena.h"
+#include "history.h"
+
+// Lengths of the rolling windows in seconds
+#ifndef STATS_WINDOWS_S
+#define STATS_WINDOWS_S 60, 3600, 86400
+#endif
+#define STATS_WINDOW_COUNT (sizeof((uint32_t[]){STATS_WINDOWS_S}) / sizeof(uint32_t))
+
+// Windows slide a bucket at a time, 1/16th of their length, so a day-long
+// window costs no more memory than a minute-long one
+#define STATS_BUCKETS 16
+
+typedef enum {
+	STATS_TEMP,      // tenths of a degree celsius
+	STATS_HUMIDITY,  // tenths of a percent
+	STATS_QUANTITIES,
+} stats_quantity;
+
+// Rolling statistics of one quantity over one window
+typedef struct {
+	int16_t min;
+	int16_t max;
+	int16_t mean;
+	int16_t ewma;  // exponentially weighted, with the window as time constant
+} stats_summary;
+
+// The window state below is only public so the arena can be sized for it
+
+// Bucket numbers are kept modulo 2^16; only the last STATS_BUCKETS matter
+typedef struct {
+	uint16_t bucket;
+	int16_t value;
+} stats_entry;
+
+// Monotonic deque of the best value in each live bucket, best at the front
+typedef struct {
+	stats_entry entries[STATS_BUCKETS];
+	uint8_t head;
+	uint8_t count;
+} stats_deque;
+
+typedef struct {
+	stats_deque min[STATS_QUANTITIES];  // increasing from the front
+	stats_deque max[STATS_QUANTITIES];  // decreasing from the front
+
+	// running sums over the live buckets, and each bucket's share of them
+	int32_t bucket_sums[STATS_QUANTITIES][STATS_BUCKETS];
+	uint16_t bucket_counts[STATS_BUCKETS];
+	int32_t sums[STATS_QUANTITIES];
+	uint32_t count;
+
+	int32_t ewma[STATS_QUANTITIES];  // 16.16 fixed point
+	uint32_t last_time_ms;
+	uint32_t bucket;  // number of the newest bucket, time / bucket length
+} stats_window;
+
+// Arena bytes taken by stats_init
+#define STATS_ARENA_BYTES ARENA_BYTES(DHT_SENSOR_COUNT * STATS_WINDOW_COUNT * sizeof(stats_window))
+
+/*
+ *	Takes the windows of each of DHT_SENSOR_COUNT sensors from the arena
+ */
+void stats_init();
+
+/*
+ *	Returns the length of window `window` in seconds
+ */
+uint32_t stats_window_s(uint window);
+
+/*
+ *	Adds a sample of `sensor` to every window, in O(1) amortised time
+ */
+void stats_push(uint sensor, const history_sample *sample);
+
+/*
+ *	Gets the statistics of `quantity` for `sensor` over `window`, as of its latest sample
+ *
+ *	Returns false if no sample has been pushed in the window.
+ */
+bool stats_get(uint sensor, uint window, stats_quantity quantity, stats_summary *summary);
+
+#endif
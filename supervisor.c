@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <stdio.h>
+#include "supervisor.h"
+#include "arena.h"
+#include "crc.h"
+#include "flashlog.h"
+#include "history.h"
+#include "pack.h"
+#include "stats.h"
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
+
+#define SUPERVISOR_MAGIC 0x52505553  // "SUPR"
+
+// Bump this whenever what a warm restart keeps changes in a way that the
+// sizes supervisor_layout covers do not show, such as reordered fields
+#define SUPERVISOR_LAYOUT_VERSION 1
+
+// The task that missed its deadline, when none did
+#define SUPERVISOR_NO_TASK 0xff
+
+static const char *const TASK_NAMES[SUPERVISOR_TASKS] = {"sampler", "display", "telemetry", "net"};
+
+// Kept across watchdog resets alongside the arena
+typedef struct {
+	uint32_t magic;
+	uint32_t layout;           // tells this firmware's retained layout from another's
+	uint32_t arena_size;
+	uint32_t restarts;         // warm restarts since the last cold start
+	volatile uint32_t time_ms; // latest supervisor_time_ms handed out
+	volatile uint32_t updating;
+	uint8_t missed;            // task behind the last restart
+} supervisor_record;
+
+static supervisor_record __uninitialized_ram(record);
+
+static bool warm = false;
+static uint32_t time_offset_ms = 0;
+static repeating_timer_t check_timer;
+
+// Deadline of each task, in ms since boot, while it is checked
+static volatile uint32_t deadlines[SUPERVISOR_TASKS];
+static volatile uint32_t checked = 0;
+
+/*
+ *	Returns a key of the layout of everything a warm restart keeps
+ *
+ *	It covers the size of every record kept and of every block the arena
+ *	hands out, in the order they are handed out, so a build that lays the
+ *	retained RAM out differently starts cold.
+ */
+uint32_t supervisor_layout() {
+	static const uint32_t layout[] = {
+		SUPERVISOR_LAYOUT_VERSION,
+		sizeof(supervisor_record),
+		DHT_SENSOR_COUNT,
+		FLASHLOG_MAGIC,
+		FLASHLOG_ARENA_BYTES,
+		sizeof(flashlog_page),
+		sizeof(pack_state),
+		HISTORY_ARENA_BYTES,
+		HISTORY_SIZE,
+		sizeof(history_sample),
+		STATS_ARENA_BYTES,
+		sizeof(stats_window),
+		STATS_WINDOWS_S,
+	};
+	// two CRCs from different starting values make a 32-bit key
+	return crc16_update(CRC16_INIT, layout, sizeof(layout)) | ((uint32_t)crc16_update(0, layout, sizeof(layout)) << 16);
+}
+
+/*
+ *	Timer callback: feeds the watchdog unless a task is overdue, in which case it restarts straight away
+ */
+bool supervisor_check(repeating_timer_t *timer) {
+	uint32_t now = to_ms_since_boot(get_absolute_time());
+	supervisor_time_ms();
+	for (uint i = 0; i < SUPERVISOR_TASKS; ++i) {
+		if ((checked & (1u << i)) && (int32_t)(now - deadlines[i]) > 0) {
+			// no need to wait for the watchdog to bite
+			record.missed = i;
+			watchdog_reboot(0, 0, 0);
+			return false;
+		}
+	}
+	watchdog_update();
+	return true;
+}
+
+void supervisor_init() {
+	warm = watchdog_caused_reboot() && record.magic == SUPERVISOR_MAGIC && record.layout == supervisor_layout() && arena_size() == record.arena_size
+		&& record.updating == 0;
+	if (warm) {
+		++record.restarts;
+		time_offset_ms = record.time_ms + 1;
+	} else {
+		record = (supervisor_record){
+			.magic = SUPERVISOR_MAGIC,
+			.layout = supervisor_layout(),
+			.arena_size = arena_size(),
+			.missed = SUPERVISOR_NO_TASK,
+		};
+	}
+	arena_init(warm);
+}
+
+bool supervisor_warm() {
+	return warm;
+}
+
+void supervisor_start() {
+	watchdog_enable(SUPERVISOR_WATCHDOG_MS, true);
+	add_repeating_timer_ms(SUPERVISOR_CHECK_MS, supervisor_check, NULL, &check_timer);
+}
+
+void supervisor_beat(supervisor_task task, uint32_t deadline_ms) {
+	uint32_t status = save_and_disable_interrupts();
+	deadlines[task] = to_ms_since_boot(get_absolute_time()) + deadline_ms;
+	checked |= 1u << task;
+	restore_interrupts(status);
+}
+
+void supervisor_rest(supervisor_task task) {
+	uint32_t status = save_and_disable_interrupts();
+	checked &= ~(1u << task);
+	restore_interrupts(status);
+}
+
+void supervisor_retained_begin() {
+	++record.updating;
+}
+
+void supervisor_retained_end() {
+	--record.updating;
+}
+
+uint32_t supervisor_time_ms() {
+	uint32_t time_ms = to_ms_since_boot(get_absolute_time()) + time_offset_ms;
+
+	// the record keeps the latest time handed out, so times after a warm
+	// restart never go backwards
+	uint32_t status = save_and_disable_interrupts();
+	if ((int32_t)(time_ms - record.time_ms) > 0) {
+		record.time_ms = time_ms;
+	}
+	restore_interrupts(status);
+	return time_ms;
+}
+
+void supervisor_dump() {
+	printf("supervisor: %s boot, %lu warm restarts, last missed by %s\n", warm ? "warm" : "cold",
+		(unsigned long)record.restarts, (record.missed < SUPERVISOR_TASKS) ? TASK_NAMES[record.missed] : "none");
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _SUPERVISOR_H
+#define _SUPERVISOR_H
+
+#include "pico/stdlib.h"
+
+// The hardware watchdog is fed from a timer interrupt, but only while every
+// task has sent a heartbeat within the time it last promised. A task that
+// misses its deadline, or anything that keeps the timer from running, such
+// as an interrupt storm from a sensor line stuck oscillating, restarts the
+// chip.
+//
+// The arena lives in RAM the runtime does not clear, so a restart caused
+// by the watchdog finds the history rings, statistics and queued flash log
+// pages as they were and carries on with them, and sample times go on from
+// where they left off.
+
+// Tasks with heartbeats
+typedef enum {
+	SUPERVISOR_SAMPLER,
+	SUPERVISOR_DISPLAY,
+	SUPERVISOR_TELEMETRY,
+	SUPERVISOR_NET,
+	SUPERVISOR_TASKS,
+} supervisor_task;
+
+// Time between checks of the deadlines, each of which feeds the watchdog
+#define SUPERVISOR_CHECK_MS 250
+
+// Time the watchdog waits for a feed before it restarts the chip; longer
+// than the interrupts are off for a flash sector erase
+#define SUPERVISOR_WATCHDOG_MS 1500
+
+/*
+ *	Works out whether this is a warm restart, with RAM kept from before a watchdog reset
+ *
+ *	Call this first, before the arena hands anything out.
+ */
+void supervisor_init();
+
+/*
+ *	Returns true if this boot is a warm restart
+ */
+bool supervisor_warm();
+
+/*
+ *	Enables the watchdog and starts checking heartbeats
+ */
+void supervisor_start();
+
+/*
+ *	Notes a heartbeat of `task`, which promises its next one within `deadline_ms`
+ *
+ *	A task is only checked from its first heartbeat on.
+ */
+void supervisor_beat(supervisor_task task, uint32_t deadline_ms);
+
+/*
+ *	Stops checking `task` until its next heartbeat, for a task with nothing to do
+ */
+void supervisor_rest(supervisor_task task);
+
+/*
+ *	Marks the start of changes to the state a warm restart keeps
+ *
+ *	A reset before the matching supervisor_retained_end leaves that state
+ *	half changed, so the next boot starts cold instead.
+ */
+void supervisor_retained_begin();
+
+/*
+ *	Marks the end of changes to the state a warm restart keeps
+ */
+void supervisor_retained_end();
+
+/*
+ *	Returns milliseconds since the last cold start, which go on across warm restarts
+ */
+uint32_t supervisor_time_ms();
+
+/*
+ *	Prints the number of warm restarts and the task that missed its deadline last
+ */
+void supervisor_dump();
+
+#endif
@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#include <string.h>
+#include "telemetry.h"
+#include "crc.h"
+#include "flashlog.h"
+#include "history.h"
+#include "pack.h"
+#include "pico/stdio_usb.h"
+#include "tusb.h"
+
+// A whole frame has to fit in the CDC transmit buffer, a flash log page with
+// its boot number in front too
+#define TELEMETRY_FRAME_SIZE CFG_TUD_CDC_TX_BUFSIZE
+_Static_assert(TELEMETRY_OVERHEAD + sizeof(uint32_t) + FLASHLOG_BLOCK_BYTES <= TELEMETRY_FRAME_SIZE, "a flash log page must fit in one frame");
+
+static uint32_t sequence = 0;
+
+// History index of the next sample to send for each sensor
+static uint32_t cursors[DHT_SENSOR_COUNT];
+
+// History total each sensor's last stats frame covered
+static uint32_t stats_sent[DHT_SENSOR_COUNT];
+
+// Ended attempts each sensor's last signal quality frame covered
+static uint32_t diag_sent[DHT_SENSOR_COUNT];
+
+// Flash log dump in progress: the page being sent, and where it stops
+static bool dumping = false;
+static uint32_t dump_page;
+static uint32_t dump_end;
+
+/*
+ *	Writes raw bytes to USB CDC; the caller has checked that they fit
+ */
+void telemetry_write(const void *data, uint len) {
+	// the stdio driver skips CR/LF translation and flushes for us
+	stdio_usb.out_chars(data, len);
+}
+
+/*
+ *	Sends one frame whose payload is `prefix` followed by `payload`, both read in place
+ */
+void telemetry_send(telemetry_type type, uint sensor, uint32_t index, const void *prefix, uint16_t prefix_length, const void *payload, uint16_t length) {
+	telemetry_header header = {
+		.magic = {TELEMETRY_MAGIC0, TELEMETRY_MAGIC1},
+		.type = type,
+		.sensor = sensor,
+		.sequence = sequence++,
+		.index = index,
+		.length = prefix_length + length,
+	};
+	uint16_t crc = crc16_update(CRC16_INIT, &header, sizeof(header));
+	crc = crc16_update(crc, prefix, prefix_length);
+	crc = crc16_update(crc, payload, length);
+
+	telemetry_write(&header, sizeof(header));
+	if (prefix_length) {
+		telemetry_write(prefix, prefix_length);
+	}
+	telemetry_write(payload, length);
+	telemetry_write(&crc, sizeof(crc));
+}
+
+/*
+ *	Completes the frame whose `length` bytes of payload are already in place after the header in `out`
+ */
+uint telemetry_finish(uint8_t *out, uint32_t sequence, telemetry_type type, uint sensor, uint32_t index, uint16_t length) {
+	telemetry_header header = {
+		.magic = {TELEMETRY_MAGIC0, TELEMETRY_MAGIC1},
+		.type = type,
+		.sensor = sensor,
+		.sequence = sequence,
+		.index = index,
+		.length = length,
+	};
+	memcpy(out, &header, sizeof(header));
+	uint16_t crc = crc16_update(CRC16_INIT, out, sizeof(header) + length);
+	memcpy(out + sizeof(header) + length, &crc, sizeof(crc));
+	return TELEMETRY_OVERHEAD + length;
+}
+
+uint telemetry_encode(uint8_t *out, uint32_t sequence, telemetry_type type, uint sensor, uint32_t index, const void *payload, uint16_t length) {
+	memcpy(out + sizeof(telemetry_header), payload, length);
+	return telemetry_finish(out, sequence, type, sensor, index, length);
+}
+
+uint telemetry_encode_packed(uint8_t *out, uint size, uint32_t sequence, uint sensor, uint32_t index, uint *count) {
+	*count = 0;
+	if (size <= TELEMETRY_OVERHEAD) {
+		return 0;
+	}
+	uint length = pack_history(sensor, index, out + sizeof(telemetry_header), MIN(size - TELEMETRY_OVERHEAD, UINT16_MAX), count);
+	if (*count == 0) {
+		return 0;
+	}
+	return telemetry_finish(out, sequence, TELEMETRY_PACKED, sensor, index, length);
+}
+
+void telemetry_get_stats(uint sensor, telemetry_stats stats[STATS_WINDOW_COUNT]) {
+	for (uint i = 0; i < STATS_WINDOW_COUNT; ++i) {
+		stats[i].window_s = stats_window_s(i);
+		stats_get(sensor, i, STATS_TEMP, &stats[i].temp);
+		stats_get(sensor, i, STATS_HUMIDITY, &stats[i].humidity);
+	}
+}
+
+void telemetry_init() {
+	stdio_init_all();
+}
+
+void telemetry_poll() {
+	if (!stdio_usb_connected()) {
+		return;
+	}
+
+	for (uint sensor = 0; sensor < dht_sensor_count(); ++sensor) {
+		// skip ahead if the ring has overwritten samples we never sent
+		if (cursors[sensor] < history_oldest(sensor)) {
+			cursors[sensor] = history_oldest(sensor);
+		}
+
+		// each frame packs as many samples as there is room for in the buffer
+		while (1) {
+			uint8_t frame[TELEMETRY_FRAME_SIZE];
+			uint count;
+			uint length = telemetry_encode_packed(frame, MIN(tud_cdc_write_available(), sizeof(frame)), sequence, sensor, cursors[sensor], &count);
+			if (length == 0) {
+				break;
+			}
+			telemetry_write(frame, length);
+			++sequence;
+			cursors[sensor] += count;
+		}
+
+		telemetry_stats stats[STATS_WINDOW_COUNT];
+		uint length = sizeof(stats);
+		if (stats_sent[sensor] == history_total(sensor) || tud_cdc_write_available() < TELEMETRY_OVERHEAD + length) {
+			continue;
+		}
+		telemetry_get_stats(sensor, stats);
+		stats_sent[sensor] = history_total(sensor);
+		telemetry_send(TELEMETRY_STATS, sensor, stats_sent[sensor], NULL, 0, stats, length);
+	}
+
+	// failing sensors have no new samples, so their signal quality goes out
+	// whenever an attempt ends: one that succeeded, was retried or gave up
+	for (uint sensor = 0; sensor < dht_sensor_count(); ++sensor) {
+		dht_diag diag;
+		dht_get_diag(sensor, &diag);
+		uint32_t ended = diag.ok + diag.retries + diag.failures;
+		if (diag_sent[sensor] == ended || tud_cdc_write_available() < TELEMETRY_OVERHEAD + sizeof(diag)) {
+			continue;
+		}
+		diag_sent[sensor] = ended;
+		telemetry_send(TELEMETRY_DIAG, sensor, ended, NULL, 0, &diag, sizeof(diag));
+	}
+
+	// the flash log goes out straight from XIP, a batch at a time
+	while (dumping) {
+		if (dump_page >= dump_end) {
+			dumping = false;
+			break;
+		}
+
+		// skip pages overwritten since the dump started
+		dump_page = MAX(dump_page, flashlog_first());
+		const flashlog_page *page = flashlog_get(dump_page);
+		if (!page || page->count == 0) {
+			++dump_page;
+			continue;
+		}
+
+		// a page's samples are packed already, so it goes out as it is
+		if (tud_cdc_write_available() < TELEMETRY_OVERHEAD + sizeof(page->boot) + page->length) {
+			break;
+		}
+		telemetry_send(TELEMETRY_PACKED_LOG, page->sensor, dump_page, &page->boot, sizeof(page->boot), page->data, page->length);
+		++dump_page;
+	}
+}
+
+void telemetry_dump_log() {
+	telemetry_dump_pages(flashlog_first(), flashlog_end() - flashlog_first());
+}
+
+void telemetry_dump_pages(uint32_t first, uint32_t count) {
+	dumping = true;
+	dump_page = first;
+	dump_end = (first < flashlog_end()) ? first + MIN(count, flashlog_end() - first) : first;
+}
+
+void telemetry_reply(uint32_t command_sequence, uint status, const void *payload, uint16_t length) {
+	if (!stdio_usb_connected() || tud_cdc_write_available() < TELEMETRY_OVERHEAD + length) {
+		return;
+	}
+	telemetry_send(TELEMETRY_REPLY, status, command_sequence, NULL, 0, payload, length);
+}
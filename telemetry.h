@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2022 Ryan Cohen
+ *
+ * SPDX-License-Identifier: MIT
+ **/
+
+#ifndef _TELEMETRY_H
+#define _TELEMETRY_H
+
+#include "pico/stdlib.h"
+#include "stats.h"
+
+// Binary frames sent over USB CDC, all fields little-endian:
+//
+//	magic     2 bytes  'T' 'M'
+//	type      1 byte   telemetry_type
+//	sensor    1 byte
+//	sequence  4 bytes  frame counter, to spot dropped frames
+//	index     4 bytes  index of the first record
+//	length    2 bytes  payload length in bytes
+//	payload   length bytes
+//	crc       2 bytes  CRC-16/CCITT-FALSE of everything before it
+//
+// tools/telemetry.py decodes them on the host.
+
+#define TELEMETRY_MAGIC0 'T'
+#define TELEMETRY_MAGIC1 'M'
+
+typedef enum {
+	// 1 and 2 were raw history_sample records, live and logged
+	TELEMETRY_STATS = 3,       // payload is a telemetry_stats per window; index is the history total they cover
+	TELEMETRY_PACKED = 4,      // payload is a pack block; index counts history pushes
+	TELEMETRY_PACKED_LOG = 5,  // payload is the u32 boot number then a flash log page's pack block; index is the page's sequence
+	TELEMETRY_REPLY = 6,       // answer to a command (see command.h): sensor is its status, index its sequence, payload the u32 settings
+	TELEMETRY_DIAG = 7,        // payload is the sensor's dht_diag; index is the attempts it covers that have ended
+} telemetry_type;
+
+typedef struct __attribute__((packed)) {
+	uint8_t magic[2];
+	uint8_t type;
+	uint8_t sensor;
+	uint32_t sequence;
+	uint32_t index;
+	uint16_t length;
+} telemetry_header;
+
+typedef struct {
+	uint32_t window_s;
+	stats_summary temp;
+	stats_summary humidity;
+} telemetry_stats;
+
+_Static_assert(sizeof(telemetry_stats) == 20, "telemetry_stats must not be padded");
+_Static_assert(sizeof(dht_diag) == 136, "dht_diag must not be padded");
+
+// Bytes a frame adds around its payload
+#define TELEMETRY_OVERHEAD (sizeof(telemetry_header) + sizeof(uint16_t))
+
+// Time between checks for new samples to send
+#define TELEMETRY_PERIOD_MS 1000
+
+/*
+ *	Brings up USB CDC for telemetry
+ */
+void telemetry_init();
+
+/*
+ *	Sends every unsent sample that fits in the USB buffer right now, in batches,
+ *	then the rolling statistics of each sensor that has new samples and the
+ *	signal quality of each that has ended an attempt
+ *
+ *	Never blocks; whatever does not fit is sent by a later call. Samples
+ *	wait in the history rings while no host is connected.
+ */
+void telemetry_poll();
+
+/*
+ *	Encodes one frame into `out`, which must have room for TELEMETRY_OVERHEAD + `length` bytes
+ *
+ *	For streams other than USB, which number their own frames with `sequence`.
+ *	Returns the length of the frame.
+ */
+uint telemetry_encode(uint8_t *out, uint32_t sequence, telemetry_type type, uint sensor, uint32_t index, const void *payload, uint16_t length);
+
+/*
+ *	Encodes a frame of as many samples of `sensor` from history index `index` as fit in `size` bytes into `out`
+ *
+ *	Returns the length of the frame, or 0 if not one sample fits, and the
+ *	number of samples in `count`.
+ */
+uint telemetry_encode_packed(uint8_t *out, uint size, uint32_t sequence, uint sensor, uint32_t index, uint *count);
+
+/*
+ *	Fills in the rolling statistics of every window for `sensor`
+ */
+void telemetry_get_stats(uint sensor, telemetry_stats stats[STATS_WINDOW_COUNT]);
+
+/*
+ *	Starts sending the whole flash log, oldest page first, alongside the live samples
+ */
+void telemetry_dump_log();
+
+/*
+ *	Starts sending `count` pages of the flash log from page `first`, or those of them still held
+ */
+void telemetry_dump_pages(uint32_t first, uint32_t count);
+
+/*
+ *	Sends the reply to the command numbered `command_sequence`, or drops it if there is no room for it now
+ */
+void telemetry_reply(uint32_t command_sequence, uint status, const void *payload, uint16_t length);
+
+#endif
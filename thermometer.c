@@ -4,21 +4,44 @@
  * SPDX-License-Identifier: BSD-3-Clause
  **/
 
-#include <math.h>
+#include <stdio.h>
 #include <string.h>
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include "pico/binary_info.h"
-
-// DHT11 reading result
-typedef struct {
-    float humidity;
-    float temp_celsius;
-} dht_reading;
+#include "hardware/sync.h"
+#ifdef AMBIENT_PIN
+#include "hardware/adc.h"
+#endif
+#include "adapt.h"
+#include "arena.h"
+#include "button.h"
+#include "command.h"
+#include "config.h"
+#include "dht.h"
+#include "display.h"
+#include "flashlog.h"
+#include "history.h"
+#if NET
+#include "net.h"
+#endif
+#include "power.h"
+#include "profile.h"
+#include "render.h"
+#include "sched.h"
+#include "stats.h"
+#include "supervisor.h"
+#include "telemetry.h"
 
 // Pins
-const uint DHT_PIN = 15;
-const uint MAX_TIMINGS = 85;
+#ifndef DHT_PINS
+#define DHT_PINS 15
+#endif
+#ifndef DHT_PIN_MASK
+#define DHT_PIN_MASK (1u << 15)
+#endif
+const uint DHT_PIN_TABLE[] = {DHT_PINS};
+_Static_assert(count_of(DHT_PIN_TABLE) <= DHT_SENSOR_COUNT, "DHT_PINS lists more than DHT_SENSOR_COUNT sensors");
 
 const uint D1_PIN = 16;
 const uint D2_PIN = 17;
@@ -36,221 +59,760 @@ const uint P_PIN = 9;
 
 const uint BUTTON_PIN = 26;
 
-const uint DIGIT_PINS[] = {
-	D1_PIN, D2_PIN, D3_PIN, D4_PIN, 
-};
-
-const uint SEGMENT_PINS[] = {
-	A_PIN, B_PIN, C_PIN, D_PIN,
-	E_PIN, F_PIN, G_PIN, P_PIN
+// An optional light sensor on an ADC pin dims the display in the dark; it
+// should read higher in brighter light
+#ifdef AMBIENT_PIN
+#if AMBIENT_PIN < 27 || AMBIENT_PIN > 29
+#error "AMBIENT_PIN must be ADC pin 27, 28 or 29"
+#endif
+#endif
+
+// The Pico W's radio is wired to GPIO 23, 24, 25 and 29
+#if NET
+#if DHT_PIN_MASK & ((1u << 23) | (1u << 24) | (1u << 25) | (1u << 29))
+#error "DHT_PINS must not use GPIO 23, 24, 25 or 29 on the Pico W"
+#endif
+#if defined(AMBIENT_PIN) && AMBIENT_PIN == 29
+#error "AMBIENT_PIN must be 27 or 28 on the Pico W"
+#endif
+#endif
+
+// Time a reading stays on the display, and its unit, by default
+const uint DISPLAY_TIME_MS = 8000;
+#if DISPLAY_CELSIUS
+#define DISPLAY_FAHRENHEIT 0
+#else
+#define DISPLAY_FAHRENHEIT 1
+#endif
+
+// With several sensors the display cycles through them, showing each one's
+// number for one step and its reading for the next two
+const uint DISPLAY_STEP_MS = 1000;
+const uint DISPLAY_STEPS_PER_SENSOR = 3;
+
+// Pressing the button while the display is on moves to the next view: the
+// latest reading, then the min, max, mean and moving average of each stats
+// window, labelled for one step like " 1hL"
+const char VIEW_STAT_LABELS[] = "LHAE";
+#define VIEW_COUNT (1 + STATS_WINDOW_COUNT * 4)
+
+// Time between background samples to start from. The interval then follows
+// how fast the readings change, from ADAPT_MIN_PERIOD_MS, by default the
+// sensor's DHT_MIN_INTERVAL_MS (2 seconds for the DHT sensors, 100 ms for an
+// SHT3x), to ADAPT_MAX_PERIOD_MS
+#ifndef SAMPLE_PERIOD_MS
+#define SAMPLE_PERIOD_MS 2000
+#endif
+#if SAMPLE_PERIOD_MS < ADAPT_MIN_PERIOD_MS || SAMPLE_PERIOD_MS > ADAPT_MAX_PERIOD_MS
+#error "SAMPLE_PERIOD_MS must be between ADAPT_MIN_PERIOD_MS and ADAPT_MAX_PERIOD_MS"
+#endif
+
+// Heartbeat deadlines: the sampler's covers a whole round of reads with
+// every retry, the display's and telemetry's a few of their periods
+#define SAMPLER_DEADLINE_MS (ADAPT_MAX_PERIOD_MS + (DHT_MAX_RETRIES + 1) * DHT_MIN_INTERVAL_MS + 1000)
+#define DISPLAY_DEADLINE_MS (3 * DISPLAY_STEP_MS)
+#define TELEMETRY_DEADLINE_MS (5 * TELEMETRY_PERIOD_MS)
+
+// Samples wait in the history rings between network bursts; at the starting
+// rate, as a burst of faster samples can afford to lose its oldest
+#if NET && NET_PERIOD_MS >= HISTORY_SIZE * SAMPLE_PERIOD_MS
+#error "NET_PERIOD_MS must be shorter than the time HISTORY_SIZE samples take"
+#endif
+
+// Settings that can be changed over USB: their defaults, from the build
+// options, and bounds
+#define ALL_SENSORS ((1u << count_of(DHT_PIN_TABLE)) - 1)
+const config_field CONFIG_FIELDS[CONFIG_KEYS] = {
+	[CONFIG_SAMPLE_PERIOD_MS] = {SAMPLE_PERIOD_MS, ADAPT_MIN_PERIOD_MS, ADAPT_MAX_PERIOD_MS},
+	[CONFIG_DISPLAY_TIME_MS] = {DISPLAY_TIME_MS, 1000, 600000},
+	[CONFIG_DISPLAY_MODE] = {RENDER_TEMP_HUMIDITY, 0, RENDER_MODES - 1},
+	[CONFIG_FAHRENHEIT] = {DISPLAY_FAHRENHEIT, 0, 1},
+	[CONFIG_BRIGHTNESS] = {DISPLAY_BRIGHTNESS_LEVELS - 1, 0, DISPLAY_BRIGHTNESS_LEVELS - 1},
+	[CONFIG_SENSORS] = {ALL_SENSORS, 1, ALL_SENSORS},
 };
 
-// 7-segment bitmasks
-const bool DIGIT_0[] = {1, 1, 1, 1, 1, 1, 0, 0};
-const bool DIGIT_1[] = {0, 1, 1, 0, 0, 0, 0, 0};
-const bool DIGIT_2[] = {1, 1, 0, 1, 1, 0, 1, 0};
-const bool DIGIT_3[] = {1, 1, 1, 1, 0, 0, 1, 0};
-const bool DIGIT_4[] = {0, 1, 1, 0, 0, 1, 1, 0};
-const bool DIGIT_5[] = {1, 0, 1, 1, 0, 1, 1, 0};
-const bool DIGIT_6[] = {1, 0, 1, 1, 1, 1, 1, 0};
-const bool DIGIT_7[] = {1, 1, 1, 0, 0, 0, 0, 0};
-const bool DIGIT_8[] = {1, 1, 1, 1, 1, 1, 1, 0};
-const bool DIGIT_9[] = {1, 1, 1, 0, 0, 1, 1, 0};
-
-const bool *DIGIT_MASKS[] = {
-	DIGIT_0, DIGIT_1, DIGIT_2, DIGIT_3, DIGIT_4,
-	DIGIT_5, DIGIT_6, DIGIT_7, DIGIT_8, DIGIT_9
+// Scheduler events
+enum {
+	EVENT_BUTTON_DOWN,
+	EVENT_BUTTON_SHORT,
+	EVENT_BUTTON_LONG,
+	EVENT_BUTTON_DOUBLE,
+	EVENT_SAMPLE,
+	EVENT_READ_DONE,
+	EVENT_DISPLAY_TIMEOUT,
+	EVENT_DISPLAY_STEP,
+	EVENT_TELEMETRY,
+	EVENT_USB_INPUT,
+	EVENT_NET,
 };
 
-// Button state
-uint64_t last_press = 0;
-bool should_read = false;
+// Sampler state
+alarm_id_t sample_alarm;
+uint32_t sample_start_ms;
+uint32_t sample_period_ms;
+uint32_t active_sensors;
+repeating_timer_t telemetry_timer;
+volatile uint32_t results_pending = 0;
+dht_status last_status[DHT_SENSOR_COUNT];
+dht_reading last_reading[DHT_SENSOR_COUNT];
 
 // 7-segment display state
-bool display[][8] = {
-	{0},
-	{0},
-	{0},
-	{0},
-};
+bool display_on = false;
+alarm_id_t display_alarm = 0;
+repeating_timer_t display_step_timer;
+uint display_step = 0;
+uint display_view = 0;
+bool display_label = false;
+bool display_mode_label = false;
+
+// How readings are shown, and for how long; a long press moves to the next
+// mode
+render_mode display_mode;
+bool display_fahrenheit;
+uint display_time_ms;
+
+// Brightness set over USB; with a light sensor, the level used in full light
+uint brightness_level;
+uint ambient_level = 4095;
+
+// Set when a save of the settings is waiting for the reads to finish
+bool config_save_pending = false;
+
+// Set when a press turned the display on, so its release does not also
+// change the view
+bool button_woke = false;
 
-void read_from_dht(dht_reading *result);
+/*
+ *	Prints a sample to the 7-segment display, scrolling it if it is too wide for four digits
+ */
+void show_sample(const history_sample *sample) {
+	PROFILE_ENTER(PROFILE_SHOW_SAMPLE);
+	char text[RENDER_TEXT_MAX];
+	if (render_reading_text(display_mode, display_fahrenheit, sample->temp_tenths, sample->humidity_tenths, text, sizeof(text))) {
+		display_scroll(text);
+	} else {
+		render_reading(display_mode, display_fahrenheit, sample->temp_tenths, sample->humidity_tenths);
+		display_show();
+	}
+	PROFILE_EXIT(PROFILE_SHOW_SAMPLE);
+}
 
 /*
- *	Sets 7-segment digit state
+ *	Sets the display brightness from the chosen level and the ambient light
  */
-void set_digit(uint selector, uint value) {
-	memcpy(&display[selector], DIGIT_MASKS[value], sizeof(bool[8]));
+void update_brightness() {
+#ifdef AMBIENT_PIN
+	// smooth out flicker from mains lighting and a hand passing by
+	adc_select_input(AMBIENT_PIN - 26);
+	ambient_level += ((int)adc_read() - (int)ambient_level) / 4;
+#endif
+	display_set_brightness((brightness_level * ambient_level + 2047) / 4095);
 }
 
 /*
- *	Turns off all 7-segment display pins
+ *	Prints dashes in place of a reading that is not there yet
  */
-void display_off() {
-	// turn off digit pins
+void show_dashes() {
 	for (uint i = 0; i < 4; ++i) {
-		gpio_put(DIGIT_PINS[i], 1);
+		set_char(i, '-');
 	}
+	display_show();
+}
 
-	// turn off segment pins
-	for (uint i = 0; i < 8; ++i) {
-		gpio_put(SEGMENT_PINS[i], 0);
+/*
+ *	Prints the latest sample of `sensor`, or dashes if there is none yet
+ *
+ *	A sensor that has never read successfully scrolls its last error instead.
+ */
+void show_latest(uint sensor) {
+	const history_sample *latest = history_get(sensor, 0);
+	if (latest) {
+		show_sample(latest);
+	} else if (last_status[sensor] != DHT_OK) {
+		char text[DISPLAY_STRIP_MAX + 1];
+		if (dht_sensor_count() > 1) {
+			snprintf(text, sizeof(text), "P%u Err %u", sensor + 1, last_status[sensor]);
+		} else {
+			snprintf(text, sizeof(text), "Err %u", last_status[sensor]);
+		}
+		display_scroll(text);
+	} else {
+		show_dashes();
 	}
 }
 
 /*
- *	Display a single digit of the 7-segment display and sleep for 2 milliseconds
+ *	Prints the current view's statistic of `sensor`, or dashes if it has no samples in the window
  */
-void display_digit(uint selector) {
-	// set digit pins
-	for (uint i = 0; i < 4; ++i) {
-		gpio_put(DIGIT_PINS[i], (selector == i) ? 0 : 1);
+void show_stat(uint sensor) {
+	uint window = (display_view - 1) / 4;
+	stats_summary temp, humidity;
+	if (!stats_get(sensor, window, STATS_TEMP, &temp) || !stats_get(sensor, window, STATS_HUMIDITY, &humidity)) {
+		show_dashes();
+		return;
+	}
+
+	history_sample sample;
+	switch ((display_view - 1) % 4) {
+	case 0:
+		sample.temp_tenths = temp.min;
+		sample.humidity_tenths = humidity.min;
+		break;
+	case 1:
+		sample.temp_tenths = temp.max;
+		sample.humidity_tenths = humidity.max;
+		break;
+	case 2:
+		sample.temp_tenths = temp.mean;
+		sample.humidity_tenths = humidity.mean;
+		break;
+	default:
+		sample.temp_tenths = temp.ewma;
+		sample.humidity_tenths = humidity.ewma;
+		break;
 	}
+	show_sample(&sample);
+}
 
-	// set segment pins
-	for (uint i = 0; i < 8; ++i) {
-		gpio_put(SEGMENT_PINS[i], display[selector][i]);
+/*
+ *	Prints the label of the current view, its window length and statistic
+ */
+void show_view_label() {
+	uint32_t length = stats_window_s((display_view - 1) / 4);
+	char unit = 's';
+	if (length % 86400 == 0) {
+		length /= 86400;
+		unit = 'd';
+	} else if (length % 3600 == 0) {
+		length /= 3600;
+		unit = 'h';
+	} else if (length % 60 == 0) {
+		length /= 60;
+		unit = 'n';
 	}
+	set_char(0, (length >= 10 && length < 100) ? '0' + length / 10 : ' ');
+	set_char(1, (length < 100) ? '0' + length % 10 : '-');
+	set_char(2, unit);
+	set_char(3, VIEW_STAT_LABELS[(display_view - 1) % 4]);
+	display_show();
+}
 
-	sleep_ms(2);
+/*
+ *	Prints the current step of the display cycle
+ */
+void show_step() {
+	uint sensor = display_step / DISPLAY_STEPS_PER_SENSOR;
+	if (display_label && display_mode_label) {
+		render_label(display_mode);
+		display_show();
+	} else if (display_label) {
+		show_view_label();
+	} else if (dht_sensor_count() > 1 && display_step % DISPLAY_STEPS_PER_SENSOR == 0) {
+		set_char(0, 'P');
+		set_char(1, ' ');
+		set_char(2, ' ');
+		set_digit(3, sensor + 1);
+		display_show();
+	} else if (display_view == 0) {
+		show_latest(sensor);
+	} else {
+		show_stat(sensor);
+	}
 }
 
 /*
- *	Display all digits of 7-segment display for 8 seconds
+ *	Returns true if no sensor has a read in progress
  */
-void display_all() {
-	for (uint i = 0; i < 1000; ++i) {
-		for (uint j = 0; j < 4; ++j) {
-			display_digit(j);
+bool sensors_idle() {
+	for (uint i = 0; i < dht_sensor_count(); ++i) {
+		if (dht_get_state(i) != DHT_STATE_IDLE) {
+			return false;
 		}
 	}
-	display_off();
+	return true;
 }
 
-void button_callback() {
-	// disable interrupts
-	gpio_set_irq_enabled(BUTTON_PIN, GPIO_IRQ_EDGE_RISE, false);
+/*
+ *	Brings the clock to full speed while the display is on or the radio is busy, and lowers it otherwise
+ *
+ *	Clock changes upset a read in progress, so nothing changes until the
+ *	sensors are idle; on_read_done calls this again once they are.
+ */
+void update_power() {
+	if (!sensors_idle()) {
+		return;
+	}
+	bool busy = display_on;
+#if NET
+	busy = busy || net_busy();
+#endif
+	if (busy) {
+		power_full();
+	} else {
+		power_low();
+	}
+}
 
-	// read from dht
-	should_read = true;
+/*
+ *	Turns the display on at `view`, or restarts it there, and keeps it on for a while
+ *
+ *	With `mode_label`, the display mode's label is shown for the first step.
+ */
+void show_view(uint view, bool mode_label) {
+	// draw straight away at whatever speed the clock is at, since the display
+	// scanner is retuned for the lowered clock too
+	if (display_on) {
+		cancel_repeating_timer(&display_step_timer);
+	}
+	display_view = view;
+
+	// show the latest cached sample straight away; a stats view is labelled
+	// for a step before the cycle starts
+	update_brightness();
+	display_mode_label = mode_label;
+	display_label = mode_label || display_view != 0;
+	display_step = display_label ? dht_sensor_count() * DISPLAY_STEPS_PER_SENSOR - 1 : 0;
+	show_step();
+	power_wake_shown();
+
+	// keep the reading on the display for a while, long enough to cycle
+	// through every sensor once
+	uint display_time = display_time_ms;
+	if (dht_sensor_count() > 1) {
+		display_time = MAX(display_time, dht_sensor_count() * DISPLAY_STEPS_PER_SENSOR * DISPLAY_STEP_MS);
+	}
+	sched_every_ms(EVENT_DISPLAY_STEP, DISPLAY_STEP_MS, &display_step_timer);
+	supervisor_beat(SUPERVISOR_DISPLAY, DISPLAY_DEADLINE_MS);
+	display_on = true;
+	sched_cancel(display_alarm);
+	display_alarm = sched_post_in_ms(EVENT_DISPLAY_TIMEOUT, display_time);
+	update_power();
+}
 
-	// enable interrupts
-	gpio_set_irq_enabled_with_callback(BUTTON_PIN, GPIO_IRQ_EDGE_RISE, true, button_callback);
+void on_button_down() {
+	// wake up on the press itself rather than waiting for the release
+	if (!display_on) {
+		button_woke = true;
+		power_wake(button_press_time_us());
+		show_view(0, false);
+	}
 }
 
-void print_dht_reading() {
-	// read from dht
-	dht_reading reading;
-	read_from_dht(&reading);
-
-	// print reading to 7-segment pins
-	float fahrenheit = (reading.temp_celsius * 9 / 5) + 32;
-	set_digit(0, (uint)(fahrenheit) / 10);
-	set_digit(1, (uint)(fahrenheit) % 10);
-	set_digit(2, (uint)(reading.humidity) / 10);
-	set_digit(3, (uint)(reading.humidity) % 10);
-	display_all();
+void on_button_short() {
+	if (button_woke) {
+		button_woke = false;
+	} else {
+		show_view(display_on ? (display_view + 1) % VIEW_COUNT : 0, false);
+	}
 }
 
-int main() {
-	// declare binary info
-	bi_decl(bi_program_name("7-segment Thermometer"));
-	bi_decl(bi_program_description("A thermometer using a DHT11 and a 7-segment display"));
-	bi_decl(bi_pin_mask_with_name(0x1f << (D1_PIN), "7-segment digit pins 0-3"));
-	bi_decl(bi_pin_mask_with_name(0xff << (A_PIN), "7-segment segment pins 0-7"));
-	bi_decl(bi_1pin_with_name(DHT_PIN, "DHT11 pin"));
-	bi_decl(bi_1pin_with_name(BUTTON_PIN, "Button input"));
-	bi_decl(bi_program_version_string("0.1.0"));
-	bi_decl(bi_program_url("https://github.com/raccog/pico-thermometer"));
+void on_button_long() {
+	// move on to the next display mode and label it
+	button_woke = false;
+	display_mode = (display_mode + 1) % RENDER_MODES;
+	config_set(CONFIG_DISPLAY_MODE, display_mode);
+	show_view(display_view, true);
+}
 
-	// init gpio pins
-    gpio_init(DHT_PIN);
-    gpio_init(BUTTON_PIN);
-	for (uint i = 0; i < sizeof(DIGIT_PINS) / sizeof(uint); ++i) {
-		gpio_init(DIGIT_PINS[i]);
+void on_button_double() {
+	// the first press has already moved on a view; go back to the live reading
+	show_view(0, false);
+}
+
+void on_display_step() {
+	supervisor_beat(SUPERVISOR_DISPLAY, DISPLAY_DEADLINE_MS);
+	update_brightness();
+	display_label = false;
+	display_step = (display_step + 1) % (dht_sensor_count() * DISPLAY_STEPS_PER_SENSOR);
+	show_step();
+}
+
+/*
+ *	Called from IRQ context when a sensor's background read finishes
+ */
+void dht_result_callback(uint sensor, dht_status status, const dht_reading *reading) {
+	last_status[sensor] = status;
+	if (status == DHT_OK) {
+		last_reading[sensor] = *reading;
 	}
-	for (uint i = 0; i < sizeof(SEGMENT_PINS) / sizeof(uint); ++i) {
-		gpio_init(SEGMENT_PINS[i]);
+	results_pending |= 1u << sensor;
+	sched_post(EVENT_READ_DONE);
+}
+
+void on_sample() {
+	// start every active sensor at once; busy ones are still reading or
+	// retrying
+	for (uint i = 0; i < dht_sensor_count(); ++i) {
+		if (active_sensors & (1u << i)) {
+			dht_request(i, dht_result_callback);
+		}
 	}
 
-	// set gpio pin directions
-	gpio_set_dir(BUTTON_PIN, GPIO_IN);
-	for (uint i = 0; i < sizeof(DIGIT_PINS) / sizeof(uint); ++i) {
-		gpio_set_dir(DIGIT_PINS[i], GPIO_OUT);
+	// a sample that comes in early because of timer jitter waits for the
+	// re-read window of the sensors that could not start yet; otherwise the
+	// next one is a whole interval away
+	int64_t wait_us = -1;
+	for (uint i = 0; i < dht_sensor_count(); ++i) {
+		if ((active_sensors & (1u << i)) && dht_get_state(i) == DHT_STATE_IDLE) {
+			wait_us = MAX(wait_us, absolute_time_diff_us(get_absolute_time(), dht_next_read_time(i)));
+		}
 	}
-	for (uint i = 0; i < sizeof(SEGMENT_PINS) / sizeof(uint); ++i) {
-		gpio_set_dir(SEGMENT_PINS[i], GPIO_OUT);
+	sched_cancel(sample_alarm);
+	if (wait_us >= 0) {
+		sample_alarm = sched_post_in_ms(EVENT_SAMPLE, wait_us / 1000 + 1);
+	} else {
+		sample_start_ms = to_ms_since_boot(get_absolute_time());
+		sample_alarm = sched_post_in_ms(EVENT_SAMPLE, adapt_period_ms());
 	}
+}
 
-	// pull down button pin
-	gpio_pull_down(BUTTON_PIN);
+void on_read_done() {
+	// gather every result that has come in since the last pass
+	uint32_t status = save_and_disable_interrupts();
+	uint32_t pending = results_pending;
+	results_pending = 0;
+	restore_interrupts(status);
 
-	// set button pin interrupt
-	gpio_set_irq_enabled_with_callback(BUTTON_PIN, GPIO_IRQ_EDGE_RISE, true, button_callback);
+	if (pending) {
+		supervisor_beat(SUPERVISOR_SAMPLER, SAMPLER_DEADLINE_MS);
+	}
 
-	// main loop
-    while (1) {
-		if (should_read) {
-			should_read = false;
-
-			// ensure it has been 2 seconds since the last button press
-			uint64_t current_time = time_us_64();
-			if (current_time <= last_press + 2000000) {
-				continue;
-			} else {
-				last_press = current_time;
-			}
+	// the rings, stats and queued log pages are kept by a warm restart, so
+	// one in the middle of changing them would leave them half changed
+	uint32_t now = supervisor_time_ms();
+	supervisor_retained_begin();
+	for (uint i = 0; i < dht_sensor_count(); ++i) {
+		if (!(pending & (1u << i)) || last_status[i] != DHT_OK) {
+			continue;
+		}
+		PROFILE_ENTER(PROFILE_READ_DONE);
+		history_sample sample = {
+			.time_ms = now,
+			.temp_tenths = last_reading[i].temp_tenths,
+			.humidity_tenths = last_reading[i].humidity_tenths,
+		};
+		history_push(i, &sample);
+		stats_push(i, &sample);
+		flashlog_push(i, &sample);
+		adapt_push(i, &sample);
+
+		// keep a visible reading up to date
+		if (display_on) {
+			show_step();
+		}
+		PROFILE_EXIT(PROFILE_READ_DONE);
+	}
+
+	// flash writes stall interrupts and clock changes upset captures, so only
+	// make them between reads
+	bool idle = sensors_idle();
+	if (idle) {
+		flashlog_flush();
+	}
+	supervisor_retained_end();
+	if (idle && config_save_pending) {
+		config_save();
+		config_save_pending = false;
+	}
+	if (idle) {
+		update_power();
+	}
 
-			// print reading
-			print_dht_reading();
+	// the round is over; a shorter interval brings the next one forward
+	if (pending && idle) {
+		uint32_t period = adapt_period_ms();
+		uint32_t next = adapt_update(now);
+		if (next < period) {
+			uint32_t elapsed = to_ms_since_boot(get_absolute_time()) - sample_start_ms;
+			sched_cancel(sample_alarm);
+			sample_alarm = sched_post_in_ms(EVENT_SAMPLE, next > elapsed ? next - elapsed : 0);
 		}
-		sleep_ms(10);
-    }
+	}
+}
+
+void on_display_timeout() {
+	supervisor_rest(SUPERVISOR_DISPLAY);
+	display_on = false;
+	display_alarm = 0;
+	cancel_repeating_timer(&display_step_timer);
+	display_off();
+	update_power();
+}
+
+void on_telemetry() {
+	supervisor_beat(SUPERVISOR_TELEMETRY, TELEMETRY_DEADLINE_MS);
+	telemetry_poll();
+}
+
+#if NET
+void on_net() {
+	uint32_t next_ms = net_poll();
+	supervisor_beat(SUPERVISOR_NET, next_ms + NET_BURST_TIMEOUT_MS);
+	sched_post_in_ms(EVENT_NET, next_ms);
+	update_power();
 }
+#endif
 
 /*
- * Taken from https://github.com/raspberrypi/pico-examples/blob/master/gpio/dht_sensor/dht.c
- *
+ *	Takes on the current settings, restarting the sampler if its period has changed
  */
-void read_from_dht(dht_reading *result) {
-    int data[5] = {0, 0, 0, 0, 0};
-    uint last = 1;
-    uint j = 0;
-
-    gpio_set_dir(DHT_PIN, GPIO_OUT);
-    gpio_put(DHT_PIN, 0);
-    sleep_ms(20);
-    gpio_set_dir(DHT_PIN, GPIO_IN);
-	sleep_us(40);
-
-    for (uint i = 0; i < MAX_TIMINGS; i++) {
-        uint count = 0;
-        while (gpio_get(DHT_PIN) == last) {
-            count++;
-            busy_wait_us_32(1);
-            if (count == 255) break;
-        }
-        last = gpio_get(DHT_PIN);
-        if (count == 255) break;
-
-        if ((i >= 4) && (i % 2 == 0)) {
-            data[j / 8] <<= 1;
-            if (count > 50) data[j / 8] |= 1;
-            j++;
-        }
-    }
-
-    if ((j >= 40) && (data[4] == ((data[0] + data[1] + data[2] + data[3]) & 0xFF))) {
-        result->humidity = (float) ((data[0] << 8) + data[1]) / 10;
-        if (result->humidity > 100) {
-            result->humidity = data[0];
-        }
-        result->temp_celsius = (float) (((data[2] & 0x7F) << 8) + data[3]) / 10;
-        if (result->temp_celsius > 125) {
-            result->temp_celsius = data[2];
-        }
-        if (data[2] & 0x80) {
-            result->temp_celsius = -result->temp_celsius;
-        }
-    }
+void apply_config() {
+	display_time_ms = config_get(CONFIG_DISPLAY_TIME_MS);
+	display_mode = config_get(CONFIG_DISPLAY_MODE);
+	display_fahrenheit = config_get(CONFIG_FAHRENHEIT);
+	brightness_level = config_get(CONFIG_BRIGHTNESS);
+	active_sensors = config_get(CONFIG_SENSORS);
+	if (display_on) {
+		update_brightness();
+		show_step();
+	}
+
+	if (sample_period_ms != config_get(CONFIG_SAMPLE_PERIOD_MS)) {
+		sample_period_ms = config_get(CONFIG_SAMPLE_PERIOD_MS);
+		adapt_init(sample_period_ms);
+		sched_cancel(sample_alarm);
+		sample_alarm = sched_post_in_ms(EVENT_SAMPLE, sample_period_ms);
+	}
+}
+
+/*
+ *	Carries out a binary command from the host and replies with the settings
+ */
+void on_command(const command_frame *frame) {
+	uint status = COMMAND_OK;
+	uint32_t value = 0;
+	bool has_value = frame->header.length == sizeof(value);
+	memcpy(&value, frame->payload, sizeof(value));
+
+	switch (frame->header.type) {
+	case COMMAND_GET:
+		break;
+	case COMMAND_SET:
+		if (!has_value || !config_set(frame->header.index, value)) {
+			status = COMMAND_INVALID;
+		}
+		apply_config();
+		break;
+	case COMMAND_SAVE:
+		// flash writes stall interrupts, so wait for the reads to finish
+		if (sensors_idle()) {
+			config_save();
+		} else {
+			config_save_pending = true;
+		}
+		break;
+	case COMMAND_DEFAULTS:
+		config_reset();
+		apply_config();
+		break;
+	case COMMAND_DUMP:
+		if (has_value) {
+			telemetry_dump_pages(frame->header.index, value);
+		} else {
+			status = COMMAND_INVALID;
+		}
+		break;
+	default:
+		status = COMMAND_UNKNOWN;
+		break;
+	}
+	telemetry_reply(frame->header.sequence, status, config_values(), CONFIG_KEYS * sizeof(uint32_t));
+}
+
+void usb_chars_callback(void *param) {
+	sched_post(EVENT_USB_INPUT);
+}
+
+void on_usb_input() {
+	// 'd' dumps the flash log as telemetry, 'l' prints its counts, '+' and
+	// '-' change the brightness, 'u' switches between fahrenheit and
+	// celsius, 'w' prints the wake latencies, 'r' the last pulse widths of
+	// each DHT sensor, 'q' the signal quality of each sensor, 'a' the
+	// sampling rate, 'm' the arena use, 's' the warm restarts, 'n' the
+	// network counts and 'p' the profile table
+	int c;
+	while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+		// binary commands from tools/config.py come in frames
+		command_frame frame;
+		bool ready;
+		if (command_feed(c, to_ms_since_boot(get_absolute_time()), &frame, &ready)) {
+			if (ready) {
+				on_command(&frame);
+			}
+			continue;
+		}
+
+		if (c == 'd') {
+			telemetry_dump_log();
+		}
+		if (c == 'l') {
+			flashlog_dump();
+		}
+		if (c == 'u') {
+			display_fahrenheit = !display_fahrenheit;
+			config_set(CONFIG_FAHRENHEIT, display_fahrenheit);
+			if (display_on) {
+				show_step();
+			}
+		}
+		if (c == 'w') {
+			power_dump();
+		}
+		if (c == 'a') {
+			adapt_dump();
+		}
+		if (c == 'm') {
+			arena_dump();
+		}
+		if (c == 's') {
+			supervisor_dump();
+		}
+		if (c == 'q') {
+			for (uint i = 0; i < dht_sensor_count(); ++i) {
+				dht_dump_diag(i);
+			}
+		}
+#if !SENSOR_SHT3X
+		if (c == 'r') {
+			// a read in progress would be printed half captured
+			for (uint i = 0; i < dht_sensor_count(); ++i) {
+				if (dht_get_state(i) == DHT_STATE_IDLE) {
+					dht_dump_pulses(i);
+				}
+			}
+		}
+#endif
+		if (c == '+' && brightness_level < DISPLAY_BRIGHTNESS_LEVELS - 1) {
+			++brightness_level;
+			config_set(CONFIG_BRIGHTNESS, brightness_level);
+			update_brightness();
+		}
+		if (c == '-' && brightness_level > 0) {
+			--brightness_level;
+			config_set(CONFIG_BRIGHTNESS, brightness_level);
+			update_brightness();
+		}
+#if NET
+		if (c == 'n') {
+			net_dump();
+		}
+#endif
+#if PROFILE
+		if (c == 'p') {
+			profile_dump();
+		}
+#endif
+	}
+}
+
+int main() {
+	// declare binary info
+	bi_decl(bi_program_name("7-segment Thermometer"));
+	bi_decl(bi_program_description("A thermometer using a " DHT_MODEL_NAME " and a 7-segment display"));
+	bi_decl(bi_pin_mask_with_name(0x1f << (D1_PIN), "7-segment digit pins 0-3"));
+	bi_decl(bi_pin_mask_with_name(0xff << (A_PIN), "7-segment segment pins 0-7"));
+	bi_decl(bi_pin_mask_with_name(DHT_PIN_MASK, DHT_MODEL_NAME " pins"));
+	bi_decl(bi_1pin_with_name(BUTTON_PIN, "Button input"));
+#ifdef AMBIENT_PIN
+	bi_decl(bi_1pin_with_name(AMBIENT_PIN, "Ambient light sensor"));
+#endif
+	bi_decl(bi_program_version_string("0.1.0"));
+	bi_decl(bi_program_url("https://github.com/raccog/pico-thermometer"));
+
+	// a watchdog reset keeps the arena, so find out first whether to trust it
+	supervisor_init();
+
+	// the build's clk_sys, before anything is timed from it
+	power_init();
+
+	// init usb telemetry and commands
+	telemetry_init();
+	stdio_set_chars_available_callback(usb_chars_callback, NULL);
+	sched_on(EVENT_USB_INPUT, on_usb_input);
+
+#if PROFILE
+	profile_init();
+#endif
+
+	// find the end of the flash log; it, the history rings and the stats take
+	// their buffers from the arena, which is sealed once startup is over
+	flashlog_init();
+	history_init();
+	stats_init();
+
+	// the saved settings take the place of the build's defaults
+	config_init(CONFIG_FIELDS);
+	sample_period_ms = config_get(CONFIG_SAMPLE_PERIOD_MS);
+	apply_config();
+
+#if NET
+	// the radio takes a PIO state machine and DMA channels of its own, so it
+	// goes before the display and sensors
+	net_init();
+#endif
+
+	// init display and dht state machines; the display claims its PIO state
+	// machine first so the sensors can take every one that is left
+	display_init(A_PIN, D1_PIN);
+	dht_init(DHT_PIN_TABLE, count_of(DHT_PIN_TABLE));
+
+	// everything timed from clk_sys has to follow it to each clock this build
+	// runs at; the radio stays up until the first burst, so the lowered clock
+	// is not safe to try yet
+#if NET
+	power_check(false);
+#else
+	power_check(true);
+#endif
+
+#ifdef AMBIENT_PIN
+	adc_init();
+	adc_gpio_init(AMBIENT_PIN);
+	adc_select_input(AMBIENT_PIN - 26);
+	ambient_level = adc_read();
+#endif
+
+	// debounce the button into press events
+	const button_events events = {
+		.down = EVENT_BUTTON_DOWN,
+		.short_press = EVENT_BUTTON_SHORT,
+		.long_press = EVENT_BUTTON_LONG,
+		.double_press = EVENT_BUTTON_DOUBLE,
+	};
+	button_init(BUTTON_PIN, &events);
+
+	// register event handlers
+	sched_on(EVENT_BUTTON_DOWN, on_button_down);
+	sched_on(EVENT_BUTTON_SHORT, on_button_short);
+	sched_on(EVENT_BUTTON_LONG, on_button_long);
+	sched_on(EVENT_BUTTON_DOUBLE, on_button_double);
+	sched_on(EVENT_SAMPLE, on_sample);
+	sched_on(EVENT_READ_DONE, on_read_done);
+	sched_on(EVENT_DISPLAY_TIMEOUT, on_display_timeout);
+	sched_on(EVENT_DISPLAY_STEP, on_display_step);
+	sched_on(EVENT_TELEMETRY, on_telemetry);
+#if NET
+	sched_on(EVENT_NET, on_net);
+#endif
+
+	arena_seal();
+
+	// idle at the low clock until the button is pressed
+	update_power();
+
+	// take the first sample now; each one schedules the next
+	adapt_init(sample_period_ms);
+	sched_post(EVENT_SAMPLE);
+	sched_every_ms(EVENT_TELEMETRY, TELEMETRY_PERIOD_MS, &telemetry_timer);
+#if NET
+	sched_post(EVENT_NET);
+#endif
+
+	// the periodic tasks are checked from now on
+	supervisor_beat(SUPERVISOR_SAMPLER, SAMPLER_DEADLINE_MS);
+	supervisor_beat(SUPERVISOR_TELEMETRY, TELEMETRY_DEADLINE_MS);
+	supervisor_start();
+
+	// main loop
+	sched_run();
 }
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Ryan Cohen
+#
+# SPDX-License-Identifier: MIT
+#
+
+"""Reads and changes a thermometer's settings over USB, without reflashing it.
+
+Needs pyserial. Prints the settings after every command:
+
+    tools/config.py /dev/ttyACM0 get
+    tools/config.py /dev/ttyACM0 set sample_period_ms 10000 set brightness 3 save
+    tools/config.py /dev/ttyACM0 defaults save
+    tools/config.py /dev/ttyACM0 dump 0 100 > log.csv
+
+Changes last until the next restart unless saved. dump sends that many
+pages of the flash log from the given page sequence number; decode the
+rest of the stream with tools/telemetry.py.
+"""
+
+import struct
+import sys
+import time
+
+import telemetry
+
+MAGIC = b"TC"
+COMMANDS = {"get": 1, "set": 2, "save": 3, "defaults": 4, "dump": 5}
+# config_key, in order
+KEYS = ["sample_period_ms", "display_time_ms", "display_mode", "fahrenheit", "brightness", "sensors"]
+STATUS = {0: "ok", 1: "unknown command", 2: "invalid"}
+TELEMETRY_REPLY = 6
+TIMEOUT_S = 2
+
+
+def command(kind, sequence, index=0, payload=b""):
+    """Returns a command frame"""
+    frame = MAGIC + struct.pack("<BBIIH", kind, 0, sequence, index, len(payload)) + payload
+    return frame + struct.pack("<H", telemetry.crc16(frame))
+
+
+def send(port, sequence, frame):
+    """Sends `frame` and returns the status and settings of its reply
+
+    Telemetry keeps coming in around the reply; a reply left in the USB
+    buffer by a full one is dropped, so gives up after TIMEOUT_S.
+    """
+    port.write(frame)
+    deadline = time.monotonic() + TIMEOUT_S
+    for kind, status, _, index, payload in telemetry.frames(port):
+        if kind == TELEMETRY_REPLY and index == sequence:
+            return status, struct.unpack(f"<{len(payload) // 4}I", payload)
+        if time.monotonic() > deadline:
+            break
+    sys.exit("no reply")
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    import serial
+    port = serial.Serial(sys.argv[1], timeout=TIMEOUT_S)
+    args = sys.argv[2:]
+    sequence = int(time.time())
+    while args:
+        name = args.pop(0)
+        sequence += 1
+        if name == "set":
+            key, value = args.pop(0), int(args.pop(0))
+            frame = command(COMMANDS[name], sequence, KEYS.index(key), struct.pack("<I", value))
+        elif name == "dump":
+            first, count = int(args.pop(0)), int(args.pop(0))
+            frame = command(COMMANDS[name], sequence, first, struct.pack("<I", count))
+        else:
+            frame = command(COMMANDS[name], sequence)
+
+        status, values = send(port, sequence, frame)
+        settings = " ".join(f"{key}={value}" for key, value in zip(KEYS, values))
+        print(f"{name}: {STATUS.get(status, status)}; {settings}", file=sys.stderr)
+        if status:
+            sys.exit(1)
+
+    # a dump carries on after its reply
+    if "dump" in sys.argv[2:]:
+        last_sequences = {}
+        print("source,boot,sensor,index,time_ms,temp_c,humidity")
+        for frame in telemetry.frames(port, follow=True):
+            telemetry.print_frame(last_sequences, "live", "", *frame)
+
+
+if __name__ == "__main__":
+    main()
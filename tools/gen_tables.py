@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Ryan Cohen
+#
+# SPDX-License-Identifier: MIT
+#
+
+"""Generates derived_tables.h, the integer lookup tables behind derived.c.
+
+Run by the build; the firmware never calls log or exp:
+
+    tools/gen_tables.py build/derived_tables.h
+"""
+
+import math
+import sys
+
+# Magnus formula constants for dew point over water, in degrees celsius
+MAGNUS_A = 17.62
+MAGNUS_B = 243.12
+
+# Fixed-point scale of the dew point's gamma terms
+GAMMA_SHIFT = 12
+DEW_TEMP_MIN = -40
+DEW_TEMP_MAX = 80
+DEW_GAMMA_MIN = -8.5
+DEW_GAMMA_MAX = 4.5
+DEW_GAMMA_STEP_SHIFT = 6
+
+HEAT_TEMP_MIN = 40
+HEAT_TEMP_MAX = 130
+HEAT_TEMP_STEP = 2
+HEAT_RH_STEP = 5
+
+
+def heat_index_f(t, rh):
+    """NWS heat index in fahrenheit, from the Rothfusz regression and its adjustments"""
+    hi = 0.5 * (t + 61 + (t - 68) * 1.2 + rh * 0.094)
+    if (hi + t) / 2 < 80:
+        return hi
+    hi = (-42.379 + 2.04901523 * t + 10.14333127 * rh - 0.22475541 * t * rh
+          - 0.00683783 * t * t - 0.05481717 * rh * rh + 0.00122874 * t * t * rh
+          + 0.00085282 * t * rh * rh - 0.00000199 * t * t * rh * rh)
+    if rh < 13 and 80 <= t <= 112:
+        hi -= (13 - rh) / 4 * math.sqrt((17 - abs(t - 95)) / 17)
+    elif rh > 85 and 80 <= t <= 87:
+        hi += (rh - 85) / 10 * (87 - t) / 5
+    return hi
+
+
+def table(name, kind, values, per_line=12):
+    lines = [f"static const {kind} {name}[{len(values)}] = {{"]
+    for i in range(0, len(values), per_line):
+        lines.append("\t" + ", ".join(str(v) for v in values[i:i + per_line]) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main():
+    scale = 1 << GAMMA_SHIFT
+    ln_rh = [round(math.log(max(p, 1) / 100) * scale) for p in range(101)]
+    gamma_t = [round(MAGNUS_A * t / (MAGNUS_B + t) * scale) for t in range(DEW_TEMP_MIN, DEW_TEMP_MAX + 1)]
+
+    step = 1 / (1 << (GAMMA_SHIFT - DEW_GAMMA_STEP_SHIFT))
+    count = round((DEW_GAMMA_MAX - DEW_GAMMA_MIN) / step) + 1
+    dew = [round(MAGNUS_B * g / (MAGNUS_A - g) * 10) for g in (DEW_GAMMA_MIN + i * step for i in range(count))]
+
+    heat = []
+    for t in range(HEAT_TEMP_MIN, HEAT_TEMP_MAX + 1, HEAT_TEMP_STEP):
+        heat += [round(heat_index_f(t, rh) * 10) for rh in range(0, 101, HEAT_RH_STEP)]
+
+    out = f"""// Generated by tools/gen_tables.py; do not edit
+
+#ifndef _DERIVED_TABLES_H
+#define _DERIVED_TABLES_H
+
+#define DEW_GAMMA_SHIFT {GAMMA_SHIFT}
+#define DEW_TEMP_MIN {DEW_TEMP_MIN}
+#define DEW_TEMP_MAX {DEW_TEMP_MAX}
+#define DEW_GAMMA_MIN {round(DEW_GAMMA_MIN * scale)}
+#define DEW_GAMMA_STEP_SHIFT {DEW_GAMMA_STEP_SHIFT}
+#define DEW_GAMMA_COUNT {count}
+
+#define HEAT_TEMP_MIN {HEAT_TEMP_MIN}
+#define HEAT_TEMP_MAX {HEAT_TEMP_MAX}
+#define HEAT_TEMP_STEP {HEAT_TEMP_STEP}
+#define HEAT_RH_STEP {HEAT_RH_STEP}
+#define HEAT_RH_COUNT {100 // HEAT_RH_STEP + 1}
+
+// ln(rh / 100) for each whole percent, scaled by 2^DEW_GAMMA_SHIFT
+{table("DEW_LN_RH", "int16_t", ln_rh)}
+
+// a * t / (b + t) for each whole degree celsius from DEW_TEMP_MIN, scaled by 2^DEW_GAMMA_SHIFT
+{table("DEW_GAMMA_T", "int16_t", gamma_t)}
+
+// Dew point in tenths of a degree celsius for each gamma step from DEW_GAMMA_MIN
+{table("DEW_POINT", "int16_t", dew)}
+
+// Heat index in tenths of a degree fahrenheit, by temperature step then humidity step
+{table("HEAT_INDEX", "int16_t", heat, 21)}
+
+#endif
+"""
+    with open(sys.argv[1], "w") as f:
+        f.write(out)
+
+
+if __name__ == "__main__":
+    main()
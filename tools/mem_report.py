@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Ryan Cohen
+#
+# SPDX-License-Identifier: MIT
+#
+
+"""Reports the flash and RAM a firmware image uses against the RP2040's budget.
+
+Run after every link by CMake; reads the ELF directly, so it needs no
+binutils:
+
+    tools/mem_report.py thermometer.elf --flash-reserved 1048576
+
+Prints each memory region's use, the arena and the biggest RAM symbols,
+and exits non-zero if the image does not fit in flash below the reserved
+region (the flash log) or leaves less than --min-free bytes of main SRAM
+for the heap and stack growth.
+"""
+
+import argparse
+import struct
+import sys
+
+FLASH = (0x10000000, 2 * 1024 * 1024)
+
+# RP2040 SRAM: 256 KB striped main RAM, then two 4 KB banks the SDK puts
+# the stacks of core 0 and core 1 in
+RAM_REGIONS = [
+    ("RAM", 0x20000000, 256 * 1024),
+    ("SCRATCH_X", 0x20040000, 4 * 1024),
+    ("SCRATCH_Y", 0x20041000, 4 * 1024),
+]
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+SHT_SYMTAB = 2
+STT_OBJECT = 1
+
+
+def read_elf(path):
+    """Returns (sections, symbols) of a 32-bit little-endian ELF
+
+    Sections are (name, addr, size, type, flags); symbols are (name, addr,
+    size, type) of every named symbol.
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+        sys.exit(f"{path}: not a 32-bit little-endian ELF")
+
+    shoff, = struct.unpack_from("<I", data, 0x20)
+    shentsize, shnum, shstrndx = struct.unpack_from("<HHH", data, 0x2E)
+    headers = [struct.unpack_from("<IIIIIIIIII", data, shoff + i * shentsize) for i in range(shnum)]
+
+    def string(table, offset):
+        start = headers[table][4] + offset
+        return data[start:data.index(b"\0", start)].decode()
+
+    sections = []
+    symbols = []
+    for name, kind, flags, addr, offset, size, link, _, _, entsize in headers:
+        sections.append((string(shstrndx, name), addr, size, kind, flags))
+        if kind != SHT_SYMTAB:
+            continue
+        for i in range(size // entsize):
+            sym_name, value, sym_size, info, _, _ = struct.unpack_from("<IIIBBH", data, offset + i * entsize)
+            if sym_name:
+                symbols.append((string(link, sym_name), value, sym_size, info & 0xF))
+    return sections, symbols
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("elf")
+    parser.add_argument("--flash-reserved", type=int, default=0, help="bytes at the top of flash the image must stay below")
+    parser.add_argument("--min-free", type=int, default=16 * 1024, help="main SRAM bytes that must be left free")
+    parser.add_argument("--top", type=int, default=8, help="biggest RAM symbols to list")
+    args = parser.parse_args()
+
+    sections, symbols = read_elf(args.elf)
+    allocated = [s for s in sections if s[4] & SHF_ALLOC and s[2]]
+    ok = True
+
+    # the image in flash is everything with contents, including the
+    # initial values of .data that are copied into RAM at boot
+    flash_used = sum(size for _, _, size, kind, _ in allocated if kind != SHT_NOBITS)
+    flash_budget = FLASH[1] - args.flash_reserved
+    print(f"{args.elf}:")
+    print(f"  FLASH      {flash_used:7} of {flash_budget:7} bytes ({100 * flash_used / flash_budget:.1f}%)")
+    if flash_used > flash_budget:
+        print("  error: the image overlaps the reserved top of flash", file=sys.stderr)
+        ok = False
+
+    for region, start, length in RAM_REGIONS:
+        used = sum(size for _, addr, size, _, _ in allocated if start <= addr < start + length)
+        print(f"  {region:10} {used:7} of {length:7} bytes ({100 * used / length:.1f}%)")
+        if region == "RAM" and length - used < args.min_free:
+            print(f"  error: only {length - used} bytes of RAM left free, below {args.min_free}", file=sys.stderr)
+            ok = False
+
+    # the stacks and the SDK's minimum heap are sections of their own, so
+    # count as used; what is left over in RAM is extra heap and stack room
+    arena = [size for name, _, size, _ in symbols if name == "arena"]
+    if arena:
+        print(f"  arena      {arena[0]:7} bytes")
+    if any(name in ("malloc", "_malloc_r") for name, _, _, _ in symbols):
+        print("  malloc is linked in")
+
+    ram_start, ram_end = RAM_REGIONS[0][1], RAM_REGIONS[-1][1] + RAM_REGIONS[-1][2]
+    objects = [(name, size) for name, addr, size, kind in symbols if kind == STT_OBJECT and ram_start <= addr < ram_end]
+    for name, size in sorted(objects, key=lambda s: -s[1])[:args.top]:
+        print(f"    {size:7}  {name}")
+
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,223 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Ryan Cohen
+#
+# SPDX-License-Identifier: MIT
+#
+
+"""Decodes thermometer telemetry frames into CSV.
+
+Live samples have an empty boot column; samples dumped from the flash log
+(send 'd' to the thermometer) carry the boot their times are relative to.
+Rolling statistics and the signal quality of each sensor come out as
+comment lines starting with '#'.
+
+Reads from a serial port (needs pyserial) or from a file of captured bytes,
+or stdin when no source is given:
+
+    tools/telemetry.py /dev/ttyACM0
+    tools/telemetry.py capture.bin > samples.csv
+
+With --udp, listens for the packets a Pico W sends instead. Their samples
+have the board's unique id as their source and the board's current boot:
+
+    tools/telemetry.py --udp 4950 > samples.csv
+
+MQTT messages carry the same packets, so the payloads of a subscription can
+be fed in on stdin too, but then only the frames inside them are decoded.
+"""
+
+import io
+import socket
+import struct
+import sys
+
+MAGIC = b"TM"
+HEADER = struct.Struct("<2sBBIIH")
+SAMPLE = struct.Struct("<IhH")
+# raw samples, as sent by firmware from before samples were packed
+TELEMETRY_SAMPLES = 1
+TELEMETRY_LOG = 2
+TELEMETRY_STATS = 3
+TELEMETRY_PACKED = 4
+TELEMETRY_PACKED_LOG = 5
+TELEMETRY_DIAG = 7
+STATS = struct.Struct("<I4h4h")
+# dht_diag: attempts, ok, checksums, retries, failures, timeouts by pulses
+# captured, data bit widths in 8 us bins, last and lowest margin
+DIAG_POSITIONS = 41
+DIAG_BINS = 16
+DIAG_BIN_US = 8
+DIAG = struct.Struct(f"<5I{DIAG_POSITIONS}H{DIAG_BINS}H2B")
+NET_MAGIC = b"TN"
+NET_HEADER = struct.Struct("<2s8sIH")
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, as computed by crc.c"""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def varint(data, pos):
+    """Returns (value, next position) of the varint at `pos`"""
+    value = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def unpack(block):
+    """Yields (time_ms, temp, humidity) of each sample of a block packed by pack.c"""
+    if len(block) < SAMPLE.size:
+        return
+    time_ms, temp, humidity = SAMPLE.unpack_from(block)
+    yield time_ms, temp, humidity
+    pos = SAMPLE.size
+    delta = 0
+    while pos < len(block):
+        change, pos = varint(block, pos)
+        delta = (delta + unzigzag(change)) & 0xFFFFFFFF
+        time_ms = (time_ms + delta) & 0xFFFFFFFF
+        changes = [block[pos] >> 4, block[pos] & 0xF]
+        pos += 1
+        for i in range(2):
+            if changes[i] == 15:
+                changes[i], pos = varint(block, pos)
+        temp += unzigzag(changes[0])
+        humidity = (humidity + unzigzag(changes[1])) & 0xFFFF
+        yield time_ms, temp, humidity
+
+
+def frames(stream, follow=False):
+    """Yields (type, sensor, sequence, index, payload) for every valid frame
+
+    With `follow`, an empty read is a timeout rather than the end of the stream.
+    """
+    buf = b""
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            if follow:
+                continue
+            return
+        buf += chunk
+
+        while True:
+            start = buf.find(MAGIC)
+            if start < 0:
+                buf = buf[-1:]
+                break
+            buf = buf[start:]
+            if len(buf) < HEADER.size:
+                break
+
+            _, kind, sensor, sequence, index, length = HEADER.unpack_from(buf)
+            end = HEADER.size + length + 2
+            if len(buf) < end:
+                break
+
+            (crc,) = struct.unpack_from("<H", buf, end - 2)
+            if crc16(buf[:end - 2]) != crc:
+                # not a real frame start; resync on the next magic
+                buf = buf[1:]
+                continue
+
+            yield kind, sensor, sequence, index, buf[HEADER.size:end - 2]
+            buf = buf[end:]
+
+
+def open_source(path):
+    """Returns (stream, follow) for a serial port, a file, or stdin"""
+    if path is None:
+        return sys.stdin.buffer, False
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial
+        return serial.Serial(path, timeout=1), True
+    return open(path, "rb"), False
+
+
+def packets(port):
+    """Yields (board, boot, frame) for every frame of every packet sent to `port`"""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", port))
+    while True:
+        packet, _ = sock.recvfrom(2048)
+        if len(packet) < NET_HEADER.size or not packet.startswith(NET_MAGIC):
+            continue
+        _, board, boot, _ = NET_HEADER.unpack_from(packet)
+        for frame in frames(io.BytesIO(packet[NET_HEADER.size:])):
+            yield board.hex(), boot, frame
+
+
+def print_frame(last_sequences, stream, live_boot, kind, sensor, sequence, index, payload):
+    """Prints the rows of one frame; `stream` and `live_boot` label its live samples"""
+    last_sequence = last_sequences.get(stream)
+    if last_sequence is not None and sequence != (last_sequence + 1) & 0xFFFFFFFF:
+        print(f"# {stream}: {sequence - last_sequence - 1} frames dropped", file=sys.stderr)
+    last_sequences[stream] = sequence
+
+    # live samples are numbered by their index in the history, logged ones
+    # by the flash page they were packed in
+    step = 1
+    if kind == TELEMETRY_PACKED:
+        source, boot = stream, live_boot
+        samples = unpack(payload)
+    elif kind == TELEMETRY_PACKED_LOG:
+        source, boot = "log", struct.unpack_from("<I", payload)[0]
+        samples = unpack(payload[4:])
+        step = 0
+    elif kind == TELEMETRY_STATS:
+        for window, *values in STATS.iter_unpack(payload):
+            temp = "/".join(f"{v / 10:.1f}" for v in values[:4])
+            humidity = "/".join(f"{v / 10:.1f}" for v in values[4:])
+            print(f"# stats {stream} sensor {sensor} over {window}s min/max/mean/ewma: temp {temp} humidity {humidity}")
+        return
+    elif kind == TELEMETRY_DIAG:
+        values = DIAG.unpack(payload)
+        attempts, ok, checksums, retries, failures = values[:5]
+        timeouts = values[5:5 + DIAG_POSITIONS]
+        widths = values[5 + DIAG_POSITIONS:5 + DIAG_POSITIONS + DIAG_BINS]
+        last_margin, min_margin = values[-2:]
+        timeouts = " ".join(f"{i}:{n}" for i, n in enumerate(timeouts) if n)
+        widths = " ".join(f"{i * DIAG_BIN_US}:{n}" for i, n in enumerate(widths) if n)
+        print(f"# quality {stream} sensor {sensor}: {attempts} attempts, {ok} ok, {checksums} checksum, {retries} retries, {failures} failed;"
+              f" margin {last_margin} us, lowest {min_margin} us; timeouts {timeouts or '-'}; widths {widths or '-'}")
+        return
+    elif kind == TELEMETRY_SAMPLES:
+        source, boot = stream, live_boot
+        samples = SAMPLE.iter_unpack(payload)
+    elif kind == TELEMETRY_LOG:
+        source, boot = "log", struct.unpack_from("<I", payload)[0]
+        samples = SAMPLE.iter_unpack(payload[4:])
+    else:
+        return
+    for i, (time_ms, temp, humidity) in enumerate(samples):
+        print(f"{source},{boot},{sensor},{index + i * step},{time_ms},{temp / 10:.1f},{humidity / 10:.1f}")
+
+def main():
+    print("source,boot,sensor,index,time_ms,temp_c,humidity")
+    last_sequences = {}
+    if len(sys.argv) > 2 and sys.argv[1] == "--udp":
+        for board, boot, frame in packets(int(sys.argv[2])):
+            print_frame(last_sequences, board, boot, *frame)
+    else:
+        source, follow = open_source(sys.argv[1] if len(sys.argv) > 1 else None)
+        for frame in frames(source, follow):
+            print_frame(last_sequences, "live", "", *frame)
+
+
+if __name__ == "__main__":
+    main()